@@ -1,7 +1,9 @@
-
+-- serials and thumbprints are bytea (API uses their upper case hex):
+-- serial is the certificate serial number without leading zero bytes
+-- (16 bytes for issued certificates), thumbprint is SHA-1 (20 bytes)
 CREATE TABLE IF NOT EXISTS public.ca (
-	"serial" varchar(250) NOT NULL,
-	"thumbprint" varchar(250) NOT NULL,
+	"serial" bytea NOT NULL,
+	"thumbprint" bytea NOT NULL,
 	"commonName" varchar(500) NOT NULL,
 	"issueDate" timestamp with time zone NOT NULL,
 	"certificate" bytea NOT NULL,
@@ -11,23 +13,80 @@ CREATE TABLE IF NOT EXISTS public.ca (
 	CONSTRAINT ca_unique_thumbprint UNIQUE ("thumbprint")
 );
 CREATE TABLE IF NOT EXISTS public.certificates (
-	"serial" varchar(250) NOT NULL,
-	"thumbprint" varchar(250) NOT NULL,
-	"caSerial" varchar(250) NOT NULL,
+	"serial" bytea NOT NULL,
+	"thumbprint" bytea NOT NULL,
+	"caSerial" bytea NOT NULL,
 	"commonName" varchar(500) NOT NULL,
 	"issueDate" timestamp with time zone NOT NULL,
 	"revokeDate" timestamp with time zone NULL,
+	"expireDate" timestamp with time zone NULL,
+	"crlPartition" integer NOT NULL DEFAULT 0,
 	CONSTRAINT certificates_pk PRIMARY KEY ("serial"),
 	CONSTRAINT certificates_unique_thumbprint UNIQUE ("thumbprint"),
 	CONSTRAINT certificates_ca_fk FOREIGN KEY ("caSerial") REFERENCES public.ca("serial")
 );
+-- databases created before expireDate was stored, NULL - never leaves CRL
+ALTER TABLE public.certificates ADD COLUMN IF NOT EXISTS "expireDate" timestamp with time zone NULL;
+-- databases created before CRL partitioning, 0 - listed in full CRL only
+ALTER TABLE public.certificates ADD COLUMN IF NOT EXISTS "crlPartition" integer NOT NULL DEFAULT 0;
 
 CREATE TABLE IF NOT EXISTS public.crl (
-	"caSerial" varchar(250) NOT NULL,
+	"caSerial" bytea NOT NULL,
+	"partition" integer NOT NULL DEFAULT 0,
 	"number" integer NOT NULL,
 	"issueDate" timestamp with time zone NOT NULL,
 	"expireDate" timestamp with time zone NOT NULL,
-	"lastSerial" varchar(250) NULL,
+	"lastSerial" bytea NULL,
 	"content" bytea NOT NULL,
-	CONSTRAINT crl_pk PRIMARY KEY ("caSerial","number")
+	CONSTRAINT crl_pk PRIMARY KEY ("caSerial","partition","number")
+);
+-- databases created before CRL partitioning, every partition numbers its CRLs
+ALTER TABLE public.crl ADD COLUMN IF NOT EXISTS "partition" integer NOT NULL DEFAULT 0;
+DO $$
+BEGIN
+	IF NOT EXISTS (SELECT 1 FROM information_schema.key_column_usage WHERE table_schema = 'public'
+		AND table_name = 'crl' AND constraint_name = 'crl_pk' AND column_name = 'partition') THEN
+		ALTER TABLE public.crl DROP CONSTRAINT IF EXISTS crl_pk;
+		ALTER TABLE public.crl ADD CONSTRAINT crl_pk PRIMARY KEY ("caSerial","partition","number");
+	END IF;
+END $$;
+
+-- databases created with varchar serials, hex text is converted once
+DO $$
+BEGIN
+	IF EXISTS (SELECT 1 FROM information_schema.columns WHERE table_schema = 'public'
+		AND table_name = 'ca' AND column_name = 'serial' AND data_type <> 'bytea') THEN
+		ALTER TABLE public.certificates DROP CONSTRAINT IF EXISTS certificates_ca_fk;
+		DROP INDEX IF EXISTS public.certificates_revoked_idx;
+		DROP INDEX IF EXISTS public.certificates_revoked_partition_idx;
+		ALTER TABLE public.ca
+			ALTER COLUMN "serial" TYPE bytea USING decode(lpad("serial", length("serial") + length("serial") % 2, '0'), 'hex'),
+			ALTER COLUMN "thumbprint" TYPE bytea USING decode("thumbprint", 'hex');
+		ALTER TABLE public.certificates
+			ALTER COLUMN "serial" TYPE bytea USING decode(lpad("serial", length("serial") + length("serial") % 2, '0'), 'hex'),
+			ALTER COLUMN "thumbprint" TYPE bytea USING decode("thumbprint", 'hex'),
+			ALTER COLUMN "caSerial" TYPE bytea USING decode(lpad("caSerial", length("caSerial") + length("caSerial") % 2, '0'), 'hex');
+		ALTER TABLE public.crl
+			ALTER COLUMN "caSerial" TYPE bytea USING decode(lpad("caSerial", length("caSerial") + length("caSerial") % 2, '0'), 'hex'),
+			ALTER COLUMN "lastSerial" TYPE bytea USING decode(lpad("lastSerial", length("lastSerial") + length("lastSerial") % 2, '0'), 'hex');
+		ALTER TABLE public.certificates ADD CONSTRAINT certificates_ca_fk FOREIGN KEY ("caSerial") REFERENCES public.ca("serial");
+	END IF;
+END $$;
+
+-- revoked certificates of CA for CRL generation
+CREATE INDEX IF NOT EXISTS certificates_revoked_idx ON public.certificates ("caSerial", "expireDate") WHERE "revokeDate" IS NOT NULL;
+-- revoked certificates of CRL partition
+CREATE INDEX IF NOT EXISTS certificates_revoked_partition_idx ON public.certificates ("caSerial", "crlPartition", "expireDate") WHERE "revokeDate" IS NOT NULL;
+
+CREATE TABLE IF NOT EXISTS public.idempotency (
+	"key" varchar(250) NOT NULL,
+	"fingerprint" varchar(64) NOT NULL,
+	"expireDate" timestamp with time zone NOT NULL,
+	"serial" bytea NULL,
+	CONSTRAINT idempotency_pk PRIMARY KEY ("key")
 );
+-- databases that stored issued containers, they hold client private keys
+ALTER TABLE public.idempotency DROP COLUMN IF EXISTS "fileName";
+ALTER TABLE public.idempotency DROP COLUMN IF EXISTS "content";
+ALTER TABLE public.idempotency ADD COLUMN IF NOT EXISTS "serial" bytea NULL;
+CREATE INDEX IF NOT EXISTS idempotency_expire_date_idx ON public.idempotency ("expireDate");
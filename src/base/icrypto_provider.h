@@ -1,10 +1,12 @@
 #ifndef _CASERV_BASE_CRYPTO_PROVIDER_H_
 #define _CASERV_BASE_CRYPTO_PROVIDER_H_
 
+#include "./../common/arena.h"
 #include "./../contracts/generated_certificate.h"
 #include "./../contracts/certificate_request.h"
 #include "./../contracts/ca_info.h"
 #include <memory>
+#include <string_view>
 
 namespace base {
 
@@ -12,11 +14,16 @@ using namespace contracts;
 class ICryptoProvider {
 public:
   virtual ~ICryptoProvider() = default;
-  virtual PKCS12ContainerUPtr GenerateClientCertitificate(const PhysicalPersonCertificateRequest& req, const CaInfo& caInfo) = 0;
-  virtual PKCS12ContainerUPtr GenerateClientCertitificate(const IndividualEntrepreneurCertificateRequest& req, const CaInfo& caInfo) = 0;
-  virtual PKCS12ContainerUPtr GenerateClientCertitificate(const JuridicalPersonCertificateRequest& req, const CaInfo& caInfo) = 0;
+  // arena holds per request temporaries, released by the caller
+  virtual PKCS12ContainerUPtr GenerateClientCertitificate(const PhysicalPersonCertificateRequest& req, const CaInfo& caInfo, common::Arena& arena) = 0;
+  virtual PKCS12ContainerUPtr GenerateClientCertitificate(const IndividualEntrepreneurCertificateRequest& req, const CaInfo& caInfo, common::Arena& arena) = 0;
+  virtual PKCS12ContainerUPtr GenerateClientCertitificate(const JuridicalPersonCertificateRequest& req, const CaInfo& caInfo, common::Arena& arena) = 0;
+  // certificate for client generated key, csr is PEM encoded PKCS#10, result has no private key
+  virtual CertificateUPtr SignCertificateRequest(const PhysicalPersonCertificateRequest& req, const std::string_view& csr, const CaInfo& caInfo, common::Arena& arena) = 0;
+  virtual CertificateUPtr SignCertificateRequest(const IndividualEntrepreneurCertificateRequest& req, const std::string_view& csr, const CaInfo& caInfo, common::Arena& arena) = 0;
+  virtual CertificateUPtr SignCertificateRequest(const JuridicalPersonCertificateRequest& req, const std::string_view& csr, const CaInfo& caInfo, common::Arena& arena) = 0;
   virtual CertificateUPtr GeneratedCACertificate(const JuridicalPersonCertificateRequest& req) = 0;
-  virtual CrlUPtr GenerateCrl(const CrlRequest& req, const CaInfo& CaInfo, const DateTimePtr &issueDate, const DateTimePtr &expireDate) = 0;
+  virtual CrlUPtr GenerateCrl(const CrlRequest& req, const CaInfo& CaInfo, const DateTime &issueDate, const DateTime &expireDate) = 0;
 };
 
 using ICryptoProviderUPtr = std::unique_ptr<ICryptoProvider>;
@@ -0,0 +1,118 @@
+#ifndef _CASERV_BENCH_BENCH_H_
+#define _CASERV_BENCH_BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+/*
+    Keep value alive, prevents the compiler from dropping benchmarked code.
+*/
+template <typename T> inline void do_not_optimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/*
+    Run fn() iterations times (after a short warmup), print ns/op and ops/s.
+*/
+template <typename TFunc>
+inline double run(const char *name, std::size_t iterations, TFunc &&fn) {
+  for (std::size_t i = 0; i < iterations / 10 + 1; ++i)
+    fn();
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i)
+    fn();
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  auto nsPerOp = elapsed / iterations;
+  std::printf("%-40s %12.1f ns/op %14.0f ops/s\n", name, nsPerOp,
+              1e9 / nsPerOp);
+  return nsPerOp;
+}
+
+/*
+    Throughput and latency distribution of one measured operation.
+    Latencies are in microseconds.
+*/
+struct Result {
+  std::string name;
+  std::size_t threads{1};
+  std::size_t operations{0};
+  double seconds{0};
+  double opsPerSecond{0};
+  double p50{0};
+  double p90{0};
+  double p99{0};
+  double max{0};
+};
+
+inline double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  auto index = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/*
+    Run fn(thread, iteration) iterations times on each of threads threads.
+    Every call is timed, each thread keeps its own samples until the end.
+*/
+template <typename TFunc>
+inline Result measure(const std::string &name, std::size_t threads,
+                      std::size_t iterations, TFunc &&fn) {
+  std::vector<std::vector<double>> samples(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      auto &local = samples[t];
+      local.reserve(iterations);
+      for (std::size_t i = 0; i < iterations; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        fn(t, i);
+        local.push_back(std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - begin)
+                            .count());
+      }
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::vector<double> all;
+  all.reserve(threads * iterations);
+  for (const auto &local : samples)
+    all.insert(all.end(), local.begin(), local.end());
+  std::sort(all.begin(), all.end());
+
+  Result result{.name = name,
+                .threads = threads,
+                .operations = all.size(),
+                .seconds = elapsed,
+                .opsPerSecond = all.size() / elapsed,
+                .p50 = percentile(all, 0.50),
+                .p90 = percentile(all, 0.90),
+                .p99 = percentile(all, 0.99),
+                .max = all.empty() ? 0 : all.back()};
+  std::printf("%-36s %3zu thr %10.1f ops/s  p50 %10.1f  p90 %10.1f  "
+              "p99 %10.1f  max %10.1f us\n",
+              result.name.c_str(), result.threads, result.opsPerSecond,
+              result.p50, result.p90, result.p99, result.max);
+  return result;
+}
+
+} // namespace bench
+
+#endif //_CASERV_BENCH_BENCH_H_
@@ -0,0 +1,137 @@
+// Timestamp decode microbenchmark: legacy shared_ptr/istringstream path vs
+// value type with fixed-format text parser and binary timestamptz.
+
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "./../common/datetime.h"
+#include "./../db/models/models.h"
+#include "./../postgre/type_spesc/binary_spec.h"
+#include "bench.h"
+
+namespace legacy {
+
+using DateTimePtr = std::shared_ptr<std::time_t>;
+
+// previous datetime::from_utcstring
+inline DateTimePtr from_utcstring(const std::string &dateTime) {
+  struct std::tm tm;
+  std::istringstream ss(dateTime);
+  ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S %Z");
+  auto dt = new std::time_t();
+  *dt = mktime(&tm);
+  return DateTimePtr(dt);
+}
+
+// previous datetime::to_utcstring (std::format replaced with put_time)
+inline std::string to_utcstring(const DateTimePtr &dt) {
+  std::ostringstream ss;
+  ss << std::put_time(std::gmtime(dt.get()), "%Y-%m-%d %H:%M:%S UTC");
+  return ss.str();
+}
+
+struct CertificateModel {
+  std::string serial;
+  std::string thumbprint;
+  std::string caSerial;
+  std::string commonName;
+  DateTimePtr issueDate;
+  DateTimePtr revokeDate;
+};
+
+} // namespace legacy
+
+using CertificateRows = db::models::RowSet<db::models::CertificateModel>;
+
+struct TextRow {
+  std::string_view serial;
+  std::string_view thumbprint;
+  std::string_view caSerial;
+  std::string_view commonName;
+  std::string_view issueDate;
+  std::string_view revokeDate;
+};
+
+int main() {
+  constexpr std::size_t iterations = 1000000;
+  const TextRow row{"6A1F0C33D2B1E4A8907F5C11AA02B3C4",
+                    "5D4C1B2A99887766554433221100FFEEDDCCBBAA",
+                    "D8B3F0B524C07A2E6BFD533EF6C23F52",
+                    "Ivanov Ivan Ivanovich",
+                    "2024-03-18 12:34:56+00",
+                    "2024-05-01 08:00:00+00"};
+  // 2024-03-18 12:34:56 UTC as binary timestamptz
+  char binaryTs[8];
+  {
+    std::int64_t micros = (1710765296LL - postgre::binary::PG_EPOCH_UNIX) * 1000000;
+    for (int i = 7; i >= 0; --i, micros >>= 8)
+      binaryTs[i] = static_cast<char>(micros & 0xff);
+  }
+
+  std::printf("timestamp parse\n");
+  bench::run("legacy istringstream + shared_ptr", iterations, [&] {
+    bench::do_not_optimize(legacy::from_utcstring(std::string(row.issueDate)));
+  });
+  bench::run("datetime::try_parse", iterations, [&] {
+    datetime::DateTime dt;
+    datetime::try_parse(row.issueDate, dt);
+    bench::do_not_optimize(dt);
+  });
+  bench::run("binary::read_timestamp", iterations, [&] {
+    bench::do_not_optimize(postgre::binary::read_timestamp(binaryTs));
+  });
+
+  std::printf("timestamp format\n");
+  auto legacyTs = legacy::from_utcstring(std::string(row.issueDate));
+  bench::run("legacy to_utcstring", iterations, [&] {
+    bench::do_not_optimize(legacy::to_utcstring(legacyTs));
+  });
+  const datetime::DateTime ts{*legacyTs};
+  bench::run("datetime::format_utc", iterations, [&] {
+    char buf[datetime::UTC_STRING_SIZE];
+    datetime::format_utc(buf, ts);
+    bench::do_not_optimize(buf);
+  });
+
+  std::printf("certificate row decode\n");
+  bench::run("legacy text row", iterations, [&] {
+    auto model = std::make_shared<legacy::CertificateModel>();
+    model->serial = row.serial;
+    model->thumbprint = row.thumbprint;
+    model->caSerial = row.caSerial;
+    model->commonName = row.commonName;
+    model->issueDate = legacy::from_utcstring(std::string(row.issueDate));
+    model->revokeDate = legacy::from_utcstring(std::string(row.revokeDate));
+    bench::do_not_optimize(model);
+  });
+  bench::run("text row", iterations, [&] {
+    auto set = std::make_shared<CertificateRows>(1, 128);
+    set->rows.emplace_back();
+    auto model = db::models::share_row(set, 0);
+    model->serial = set->arena.Store(row.serial);
+    model->thumbprint = set->arena.Store(row.thumbprint);
+    model->caSerial = set->arena.Store(row.caSerial);
+    model->commonName = set->arena.Store(row.commonName);
+    model->issueDate = datetime::from_utcstring(row.issueDate);
+    model->revokeDate = datetime::from_utcstring(row.revokeDate);
+    bench::do_not_optimize(model);
+  });
+  bench::run("binary row", iterations, [&] {
+    auto set = std::make_shared<CertificateRows>(1, 128);
+    set->rows.emplace_back();
+    auto model = db::models::share_row(set, 0);
+    model->serial = set->arena.Store(row.serial);
+    model->thumbprint = set->arena.Store(row.thumbprint);
+    model->caSerial = set->arena.Store(row.caSerial);
+    model->commonName = set->arena.Store(row.commonName);
+    model->issueDate = postgre::binary::read_timestamp(binaryTs);
+    model->revokeDate = postgre::binary::read_timestamp(binaryTs);
+    bench::do_not_optimize(model);
+  });
+  return 0;
+}
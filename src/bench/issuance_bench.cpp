@@ -0,0 +1,318 @@
+// Issuance benchmark: key generation, certificate signing, PKCS12 build, CRL
+// generation and end-to-end CaService issuance at 1..N threads.
+//
+// Usage: issuance_bench [--threads N] [--iterations M]
+//                       [--crl-sizes 1000,100000,1000000] [--json out.json]
+//
+// Uses the in-memory database, set CASERV_BENCH_PGDB to a connection
+// string to run the end-to-end part against PostgreSQL (requires a build with
+// CASERV_BENCH_PG). Requires the gost engine, same as the service.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/x509.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./../common/appsettings.h"
+#include "./../common/arena.h"
+#include "./../common/datetime.h"
+#include "./../inmemory/memory_database.h"
+#include "./../libs/json.hpp"
+#include "./../openssl/crypto_provider.h"
+#include "./../openssl/defines.h"
+#include "./../openssl/utils.h"
+#include "./../service/caservice.h"
+#include "bench.h"
+
+#ifdef CASERV_BENCH_PG
+#include "./../postgre/pgdatabase.h"
+#endif
+
+using json = nlohmann::json;
+using namespace contracts;
+using namespace service::models;
+
+struct Options {
+  std::size_t threads{4};
+  std::size_t iterations{100};
+  std::vector<std::size_t> crlSizes{1000, 100000, 1000000};
+  std::string jsonPath;
+};
+
+static std::vector<std::size_t> parse_sizes(const std::string &value) {
+  std::vector<std::size_t> result;
+  std::size_t start = 0;
+  while (start < value.size()) {
+    auto end = value.find(',', start);
+    if (end == std::string::npos)
+      end = value.size();
+    result.push_back(std::stoul(value.substr(start, end - start)));
+    start = end + 1;
+  }
+  return result;
+}
+
+static Options parse_options(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string_view name(argv[i]);
+    std::string value(argv[i + 1]);
+    if (name == "--threads")
+      options.threads = std::stoul(value);
+    else if (name == "--iterations")
+      options.iterations = std::stoul(value);
+    else if (name == "--crl-sizes")
+      options.crlSizes = parse_sizes(value);
+    else if (name == "--json")
+      options.jsonPath = value;
+    else
+      std::fprintf(stderr, "unknown option %s\n", argv[i]);
+  }
+  return options;
+}
+
+// same key parameters as the provider uses for GostR3410_2012_256
+static EVP_PKEY *generate_key() {
+  EVP_PKEY *pkey = nullptr;
+  auto ctx = EVP_PKEY_CTX_new_id(NID_id_GostR3410_2012_256, nullptr);
+  if (ctx == nullptr)
+    return nullptr;
+  if (EVP_PKEY_keygen_init(ctx) > 0 &&
+      EVP_PKEY_CTX_ctrl(ctx, NID_id_GostR3410_2012_256, EVP_PKEY_OP_KEYGEN,
+                        EVP_PKEY_CTRL_GOST_PARAMSET,
+                        NID_id_tc26_gost_3410_2012_256_paramSetA,
+                        nullptr) > 0)
+    EVP_PKEY_keygen(ctx, &pkey);
+  EVP_PKEY_CTX_free(ctx);
+  return pkey;
+}
+
+static std::string create_csr(EVP_PKEY *pkey) {
+  auto req = X509_REQ_new();
+  X509_REQ_set_version(req, 0);
+  X509_NAME_add_entry_by_txt(X509_REQ_get_subject_name(req), "CN",
+                             MBSTRING_UTF8, (const unsigned char *)"bench", -1,
+                             -1, 0);
+  X509_REQ_set_pubkey(req, pkey);
+  X509_REQ_sign(req, pkey, EVP_get_digestbynid(NID_id_GostR3411_2012_256));
+  auto bio = BIO_new(BIO_s_mem());
+  PEM_write_bio_X509_REQ(bio, req);
+  char *data = nullptr;
+  auto len = BIO_get_mem_data(bio, &data);
+  std::string result(data, len);
+  BIO_free(bio);
+  X509_REQ_free(req);
+  return result;
+}
+
+static std::array<std::byte, SERIAL_LEN> random_serial() {
+  std::array<std::byte, SERIAL_LEN> bytes;
+  RAND_bytes(reinterpret_cast<unsigned char *>(bytes.data()), bytes.size());
+  bytes[0] &= std::byte{0x7F};
+  return bytes;
+}
+
+static IssueCertificateModel client_model() {
+  IssueCertificateModel model;
+  model.subjectType = SujectTypeEnum::PhysicalPerson;
+  model.algorithm = AlgorithmEnum::GostR3410_2012_256;
+  model.ttlInDays = 365;
+  model.country = "RU";
+  model.localityName = "Saint Petersburg";
+  model.stateOrProvinceName = "78 Saint Petersburg";
+  model.emailAddress = "test@testemail.ru";
+  model.inn = "123456789012";
+  model.snils = "12334536322";
+  model.givenName = "Ivan Ivanovich";
+  model.surname = "Ivanov";
+  model.pin = "you_secret_pin_for_pfx";
+  return model;
+}
+
+static db::IDataBasePtr create_database() {
+  AppSettings settings;
+  auto connString = settings.GetParam("CASERV_BENCH_PGDB", "");
+  if (connString.empty())
+    return std::make_shared<inmemory::MemoryDatabase>();
+#ifdef CASERV_BENCH_PG
+  std::printf("database: postgresql\n");
+  return std::make_shared<postgre::PgDatabase>(connString);
+#else
+  std::printf("CASERV_BENCH_PGDB ignored, built without CASERV_BENCH_PG\n");
+  return std::make_shared<inmemory::MemoryDatabase>();
+#endif
+}
+
+static json to_json(const bench::Result &result) {
+  return json{{"name", result.name},
+              {"threads", result.threads},
+              {"operations", result.operations},
+              {"seconds", result.seconds},
+              {"opsPerSecond", result.opsPerSecond},
+              {"latencyUs",
+               {{"p50", result.p50},
+                {"p90", result.p90},
+                {"p99", result.p99},
+                {"max", result.max}}}};
+}
+
+int main(int argc, char **argv) {
+  auto options = parse_options(argc, argv);
+  spdlog::set_level(spdlog::level::warn);
+
+  auto key = generate_key();
+  if (key == nullptr) {
+    std::printf("GOST key generation failed, is the gost engine configured?\n");
+    return 1;
+  }
+
+  auto profiles = openssl::CertificateProfiles::Load("");
+  auto database = create_database();
+  serivce::CaService service(
+      database, std::make_unique<openssl::OpensslCryptoProvider>(profiles));
+  openssl::OpensslCryptoProvider crypto(profiles);
+
+  CreateCertificateAuthorityModel caModel;
+  caModel.algorithm = AlgorithmEnum::GostR3410_2012_256;
+  caModel.ttlInDays = 3650;
+  caModel.organizationName = "Bench CA";
+  caModel.country = "RU";
+  caModel.innLe = "2234467890";
+  caModel.ogrn = "2224567890123";
+  caModel.publicUrl = "http://localhost:8080";
+  auto ca = service.CreateCA(caModel);
+  auto caSerial = std::string(ca->serial);
+  auto caRow = database->GetCa(caSerial);
+  CaInfo caInfo{.serial = caSerial,
+                .crlDistributionPoints = {"http://localhost:8080/crl/" + caSerial + ".crl"},
+                .crlPartitionDistributionPoints = {},
+                .ocspEndPoints = {},
+                .caEndPoints = {"http://localhost:8080/crt/" + caSerial + ".crt"},
+                .privateKey = caRow->privateKey,
+                .certificate = caRow->certificate};
+
+  auto model = client_model();
+  PhysicalPersonCertificateRequest req;
+  req.algorithm = model.algorithm;
+  req.commonName = "Ivanov Ivan Ivanovich";
+  req.country = model.country;
+  req.emailAddress = model.emailAddress;
+  req.ttlInDays = model.ttlInDays;
+  req.inn = model.inn;
+  req.snils = model.snils;
+  req.givenName = model.givenName;
+  req.surname = model.surname;
+  req.pin = model.pin;
+  auto csr = create_csr(key);
+  auto clientProfile =
+      profiles->Find(openssl::CertificateProfiles::DEFAULT_CLIENT_PROFILE);
+
+  std::vector<bench::Result> results;
+  auto iterations = options.iterations;
+
+  results.push_back(bench::measure("keygen gost2012_256", 1, iterations,
+                                   [&](std::size_t, std::size_t) {
+                                     auto pkey = generate_key();
+                                     bench::do_not_optimize(pkey);
+                                     EVP_PKEY_free(pkey);
+                                   }));
+
+  results.push_back(bench::measure(
+      "sign csr", 1, iterations, [&](std::size_t, std::size_t) {
+        std::array<std::byte, 4096> buffer;
+        common::Arena arena(buffer.data(), buffer.size());
+        bench::do_not_optimize(
+            crypto.SignCertificateRequest(req, csr, caInfo, arena));
+      }));
+
+  auto signedCert = [&] {
+    std::array<std::byte, 4096> buffer;
+    common::Arena arena(buffer.data(), buffer.size());
+    auto cert = crypto.SignCertificateRequest(req, csr, caInfo, arena);
+    auto bio = BIO_new_mem_buf(cert->certificate.data(),
+                               (int)cert->certificate.size());
+    auto x509 = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    return x509;
+  }();
+  results.push_back(bench::measure(
+      "pkcs12 default profile", 1, iterations, [&](std::size_t, std::size_t) {
+        bench::do_not_optimize(openssl::create_pfx(
+            key, signedCert, signedCert, nullptr, model.pin.c_str(),
+            clientProfile->pkcs12));
+      }));
+  X509_free(signedCert);
+
+  results.push_back(bench::measure(
+      "generate client container", 1, iterations,
+      [&](std::size_t, std::size_t) {
+        std::array<std::byte, 4096> buffer;
+        common::Arena arena(buffer.data(), buffer.size());
+        bench::do_not_optimize(
+            crypto.GenerateClientCertitificate(req, caInfo, arena));
+      }));
+
+  auto now = datetime::utc_now();
+  for (auto size : options.crlSizes) {
+    CrlRequest crlReq;
+    crlReq.number = 1;
+    // entries view the serials
+    std::vector<std::array<std::byte, SERIAL_LEN>> serials(size);
+    crlReq.entries.reserve(size);
+    for (auto &serial : serials) {
+      serial = random_serial();
+      crlReq.entries.push_back(
+          CrlEntry{.serialNumber = serial, .revokationDate = now});
+    }
+    // keep total work bounded, a 1M entry CRL takes seconds
+    auto crlIterations = std::max<std::size_t>(
+        1, std::min<std::size_t>(iterations, 100000 / size));
+    results.push_back(bench::measure(
+        "crl " + std::to_string(size) + " entries", 1, crlIterations,
+        [&](std::size_t, std::size_t) {
+          bench::do_not_optimize(crypto.GenerateCrl(
+              crlReq, caInfo, now, datetime::add_days(now, 1)));
+        }));
+  }
+
+  // 1, 2, 4, ... and the requested count itself
+  std::vector<std::size_t> threadCounts;
+  for (std::size_t threads = 1; threads < options.threads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(std::max<std::size_t>(options.threads, 1));
+  for (auto threads : threadCounts) {
+    results.push_back(bench::measure(
+        "issue end-to-end", threads, iterations,
+        [&](std::size_t, std::size_t) {
+          bench::do_not_optimize(
+              service.CreateClientCertificate(caSerial, model));
+        }));
+  }
+
+  EVP_PKEY_free(key);
+
+  if (!options.jsonPath.empty()) {
+    json report{{"openssl", OPENSSL_VERSION_TEXT},
+                {"timestamp", std::time(nullptr)},
+                {"iterations", iterations},
+                {"results", json::array()}};
+    for (const auto &result : results)
+      report["results"].push_back(to_json(result));
+    std::ofstream(options.jsonPath) << report.dump(2) << std::endl;
+    std::printf("report written to %s\n", options.jsonPath.c_str());
+  }
+  return 0;
+}
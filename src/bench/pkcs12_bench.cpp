@@ -0,0 +1,90 @@
+// Client container build cost: PKCS12 at several KDF/MAC iteration counts
+// vs PEM bundle with PKCS8 encrypted key. Uses GOST algorithms if the gost
+// engine is configured, EC P-256 with AES otherwise.
+
+#include <cstdio>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include "./../openssl/utils.h"
+#include "bench.h"
+
+static EVP_PKEY *generate_key(bool gost) {
+  EVP_PKEY *pkey = nullptr;
+  auto ctx = gost ? EVP_PKEY_CTX_new_id(NID_id_GostR3410_2012_256, nullptr)
+                  : EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  if (ctx == nullptr)
+    return nullptr;
+  if (EVP_PKEY_keygen_init(ctx) > 0) {
+    if (gost)
+      EVP_PKEY_CTX_ctrl(ctx, NID_id_GostR3410_2012_256, EVP_PKEY_OP_KEYGEN,
+                        EVP_PKEY_CTRL_GOST_PARAMSET,
+                        NID_id_tc26_gost_3410_2012_256_paramSetA, nullptr);
+    else
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1);
+    EVP_PKEY_keygen(ctx, &pkey);
+  }
+  EVP_PKEY_CTX_free(ctx);
+  return pkey;
+}
+
+static X509 *self_signed(EVP_PKEY *pkey, const EVP_MD *md) {
+  auto cert = X509_new();
+  X509_set_version(cert, 2);
+  ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+  X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+  X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+  X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_UTF8,
+                             (const unsigned char *)"bench", -1, -1, 0);
+  X509_set_issuer_name(cert, X509_get_subject_name(cert));
+  X509_set_pubkey(cert, pkey);
+  X509_sign(cert, pkey, md);
+  return cert;
+}
+
+int main() {
+  constexpr std::size_t iterations = 200;
+  const char *pin = "you_secret_pin_for_pfx";
+
+  auto gost = EVP_get_cipherbynid(NID_id_Gost28147_89) != nullptr;
+  auto pkey = generate_key(gost);
+  if (pkey == nullptr) {
+    std::printf("key generation failed\n");
+    return 1;
+  }
+  auto md = gost ? EVP_get_digestbynid(NID_id_GostR3411_2012_256) : EVP_sha256();
+  auto cert = self_signed(pkey, md);
+
+  openssl::Pkcs12Options base;
+  if (!gost) {
+    base.keyPbe = NID_aes_256_cbc;
+    base.certPbe = NID_aes_256_cbc;
+    base.macDigest = NID_sha256;
+  } else {
+    base.macDigest = NID_id_GostR3411_2012_256;
+  }
+  std::printf("suite: %s\n", gost ? "GOST 28147-89 / GOST R 34.11-2012"
+                                  : "AES-256-CBC / SHA-256 (no gost engine)");
+
+  char name[64];
+  for (int iter : {1, 256, 2048, 10000}) {
+    auto options = base;
+    options.iterations = iter;
+    options.macIterations = iter;
+    std::snprintf(name, sizeof(name), "pkcs12 iter=%d", iter);
+    bench::run(name, iterations, [&] {
+      bench::do_not_optimize(
+          openssl::create_pfx(pkey, cert, cert, nullptr, pin, options));
+    });
+    std::snprintf(name, sizeof(name), "pem pkcs8 iter=%d", iter);
+    bench::run(name, iterations, [&] {
+      bench::do_not_optimize(
+          openssl::create_pem_bundle(pkey, cert, cert, pin, options));
+    });
+  }
+
+  X509_free(cert);
+  EVP_PKEY_free(pkey);
+  return 0;
+}
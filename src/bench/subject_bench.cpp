@@ -0,0 +1,95 @@
+// Subject construction microbenchmark: X509_NAME built from text attribute
+// names (string/OID lookup per entry) vs pre-resolved attribute objects.
+
+#include <array>
+#include <cstddef>
+#include <openssl/x509.h>
+#include <string_view>
+#include <utility>
+
+#include "./../common/arena.h"
+#include "./../openssl/subject_builder.h"
+#include "./../openssl/utils.h"
+#include "bench.h"
+
+namespace legacy {
+
+// previous subject layout, attributes by text name
+inline std::array<std::pair<std::string_view, std::string_view>, 15>
+subject(const contracts::JuridicalPersonCertificateRequest &req) {
+  return {{{"CN", req.commonName},
+           {"C", req.country},
+           {"localityName", req.localityName},
+           {"stateOrProvinceName", req.stateOrProvinceName},
+           {"streetAddress", req.streetAddress},
+           {"emailAddress", req.emailAddress},
+           {"INN", req.inn},
+           {"SNILS", req.snils},
+           {"givenName", req.givenName},
+           {"surname", req.surname},
+           {"1.2.643.100.4", req.innLe},
+           {"OGRN", req.ogrn},
+           {"O", req.organizationName},
+           {"OU", req.organizationUnitName},
+           {"title", req.title}}};
+}
+
+} // namespace legacy
+
+int main() {
+  constexpr std::size_t iterations = 100000;
+
+  contracts::JuridicalPersonCertificateRequest req;
+  req.commonName = "OOO Roga i Kopyta";
+  req.localityName = "Saint Petersburg";
+  req.stateOrProvinceName = "78 Saint Petersburg";
+  req.streetAddress = "Bolshaya Morskaya";
+  req.emailAddress = "test@testemail.ru";
+  req.inn = "123456789012";
+  req.snils = "12334536322";
+  req.givenName = "Ivan Ivanovich";
+  req.surname = "Ivanov";
+  req.innLe = "2234467890";
+  req.ogrn = "2224567890123";
+  req.organizationName = "OOO Roga i Kopyta";
+  req.organizationUnitName = "Directorate";
+  req.title = "Director";
+
+  // registers 1.2.643.100.4, the legacy path resolves it by OID text
+  openssl::subject_objects();
+  openssl::_::JuridicalPersonCertificateSubjectBuilder builder;
+
+  std::printf("attribute resolution, 15 attributes\n");
+  bench::run("legacy OBJ_txt2obj", iterations, [&] {
+    for (const auto &[field, value] : legacy::subject(req)) {
+      auto object = OBJ_txt2obj(field.data(), 0);
+      bench::do_not_optimize(object);
+      ASN1_OBJECT_free(object);
+    }
+  });
+  bench::run("pre-resolved objects", iterations, [&] {
+    for (std::size_t i = 0; i < openssl::SUBJECT_ATTRIBUTES.size(); ++i)
+      bench::do_not_optimize(
+          openssl::subject_object(static_cast<openssl::SubjectAttribute>(i)));
+  });
+
+  std::printf("juridical person subject, 15 attributes\n");
+  bench::run("legacy by text name", iterations, [&] {
+    auto name = X509_NAME_new();
+    for (const auto &[field, value] : legacy::subject(req))
+      openssl::NameAddEntry(name, field, value);
+    bench::do_not_optimize(name);
+    X509_NAME_free(name);
+  });
+  bench::run("builder + pre-resolved objects", iterations, [&] {
+    std::array<std::byte, 1024> buffer;
+    common::Arena arena(buffer.data(), buffer.size());
+    auto name = X509_NAME_new();
+    for (const auto &[attribute, value] :
+         builder.SubjectName(req, arena.Resource()))
+      openssl::NameAddEntry(name, openssl::subject_object(attribute), value);
+    bench::do_not_optimize(name);
+    X509_NAME_free(name);
+  });
+  return 0;
+}
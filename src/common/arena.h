@@ -0,0 +1,106 @@
+#ifndef _CASERV_COMMON_ARENA_H_
+#define _CASERV_COMMON_ARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+
+namespace common {
+
+/*
+    Pass-through memory resource that counts allocations.
+*/
+class CountingResource : public std::pmr::memory_resource {
+public:
+  explicit CountingResource(
+      std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : _upstream(upstream) {}
+
+  std::size_t Allocations() const { return _allocations; }
+  std::size_t Bytes() const { return _bytes; }
+
+protected:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    ++_allocations;
+    _bytes += bytes;
+    return _upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *p, std::size_t bytes,
+                     std::size_t alignment) override {
+    _upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+private:
+  std::pmr::memory_resource *_upstream;
+  std::size_t _allocations{0};
+  std::size_t _bytes{0};
+};
+
+struct ArenaStats {
+  std::size_t allocations;         // served by the arena
+  std::size_t bytes;
+  std::size_t upstreamAllocations; // blocks taken from the heap
+  std::size_t upstreamBytes;
+};
+
+/*
+    Monotonic arena. Memory is taken from upstream in large blocks (or from
+    caller provided buffer first) and released all at once when the arena is
+    destroyed. Not thread safe, use one arena per request.
+*/
+class Arena {
+public:
+  explicit Arena(std::size_t initialSize = 1024)
+      : _resource(std::max<std::size_t>(initialSize, 1), &_upstream),
+        _front(&_resource) {}
+  Arena(void *buffer, std::size_t size)
+      : _resource(buffer, size, &_upstream), _front(&_resource) {}
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena() = default;
+
+  std::pmr::memory_resource *Resource() { return &_front; }
+
+  /*
+      Copy string into arena, returned view lives as long as the arena.
+  */
+  std::string_view Store(std::string_view value) {
+    if (value.empty())
+      return std::string_view();
+    auto data = static_cast<char *>(_front.allocate(value.size(), 1));
+    std::memcpy(data, value.data(), value.size());
+    return std::string_view(data, value.size());
+  }
+
+  std::span<const std::byte> Store(std::span<const std::byte> value) {
+    if (value.empty())
+      return std::span<const std::byte>();
+    auto data = static_cast<std::byte *>(_front.allocate(value.size(), 1));
+    std::memcpy(data, value.data(), value.size());
+    return std::span<const std::byte>(data, value.size());
+  }
+
+  ArenaStats Stats() const {
+    return ArenaStats{.allocations = _front.Allocations(),
+                      .bytes = _front.Bytes(),
+                      .upstreamAllocations = _upstream.Allocations(),
+                      .upstreamBytes = _upstream.Bytes()};
+  }
+
+private:
+  CountingResource _upstream;
+  std::pmr::monotonic_buffer_resource _resource;
+  CountingResource _front;
+};
+
+} // namespace common
+
+#endif //_CASERV_COMMON_ARENA_H_
@@ -1,60 +1,205 @@
 #ifndef _CASERV_COMMON_DATETIME_H_
 #define _CASERV_COMMON_DATETIME_H_
 
-#include <bits/chrono.h>
 #include <chrono>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
 #include <ctime>
-#include <format>
-#include <iomanip>
-#include <memory>
-#include <sstream>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 
 namespace datetime {
 
-using DateTime = std::time_t;
-using DateTimePtr = std::shared_ptr<DateTime>;
+/*
+    UTC timestamp, seconds since unix epoch. Plain value type, no allocations.
+*/
+struct DateTime {
+  std::time_t value{0};
+  constexpr auto operator<=>(const DateTime &) const = default;
+};
 
-inline std::string utc_now_str() {
-  auto t = std::chrono::system_clock::now();
-  return std::format("{:%Y-%m-%d %H:%M:%S %Z}", t);
+// Nullable timestamp (revokeDate etc.)
+using DateTimeOpt = std::optional<DateTime>;
+
+// "YYYY-MM-DD HH:MM:SS UTC"
+constexpr std::size_t UTC_STRING_SIZE = 23;
+constexpr std::time_t SECONDS_PER_DAY = 86400;
+
+namespace detail {
+
+// http://howardhinnant.github.io/date_algorithms.html
+constexpr std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+struct Civil {
+  std::int64_t year;
+  unsigned month;
+  unsigned day;
+};
+
+constexpr Civil civil_from_days(std::int64_t z) {
+  z += 719468;
+  const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = static_cast<unsigned>(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+  const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+  return Civil{static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2), m, d};
+}
+
+inline bool read_digits(const char *&p, const char *end, int count, int &out) {
+  if (end - p < count)
+    return false;
+  int result = 0;
+  for (int i = 0; i < count; ++i, ++p) {
+    unsigned digit = static_cast<unsigned char>(*p) - '0';
+    if (digit > 9)
+      return false;
+    result = result * 10 + static_cast<int>(digit);
+  }
+  out = result;
+  return true;
+}
+
+inline char *write_digits(char *p, unsigned value, int count) {
+  for (int i = count - 1; i >= 0; --i) {
+    p[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  return p + count;
 }
 
-inline DateTimePtr utc_now() {
-  auto t = std::chrono::system_clock::now();
-  auto dt = new DateTime();
-  *dt = std::chrono::system_clock::to_time_t(t);
-  return DateTimePtr(dt);
+} // namespace detail
+
+/*
+    Parse timestamp in PostgreSQL ISO output format:
+    YYYY-MM-DD HH:MM:SS[.ffffff][+HH[:MM[:SS]] | Z | UTC]
+    Timestamps without zone are treated as UTC.
+*/
+inline bool try_parse(std::string_view text, DateTime &result) noexcept {
+  const char *p = text.data();
+  const char *end = p + text.size();
+  int year, month, day, hour, minute, second;
+  if (!detail::read_digits(p, end, 4, year) || p == end || *p++ != '-' ||
+      !detail::read_digits(p, end, 2, month) || p == end || *p++ != '-' ||
+      !detail::read_digits(p, end, 2, day) || p == end ||
+      (*p != ' ' && *p != 'T') || !detail::read_digits(++p, end, 2, hour) ||
+      p == end || *p++ != ':' || !detail::read_digits(p, end, 2, minute) ||
+      p == end || *p++ != ':' || !detail::read_digits(p, end, 2, second))
+    return false;
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 24 ||
+      minute > 59 || second > 60)
+    return false;
+
+  // fractional seconds are dropped
+  if (p != end && *p == '.') {
+    ++p;
+    while (p != end && static_cast<unsigned>(*p - '0') <= 9)
+      ++p;
+  }
+
+  std::time_t offset = 0;
+  if (p != end && *p == ' ')
+    ++p;
+  if (p != end) {
+    if (*p == 'Z' && p + 1 == end) {
+      p = end;
+    } else if (text.substr(p - text.data()) == "UTC") {
+      p = end;
+    } else if (*p == '+' || *p == '-') {
+      const int sign = *p++ == '-' ? -1 : 1;
+      int oh = 0, om = 0, os = 0;
+      if (!detail::read_digits(p, end, 2, oh))
+        return false;
+      if (p != end && *p == ':')
+        ++p;
+      if (p != end && !detail::read_digits(p, end, 2, om))
+        return false;
+      if (p != end && *p == ':')
+        ++p;
+      if (p != end && !detail::read_digits(p, end, 2, os))
+        return false;
+      offset = sign * (oh * 3600 + om * 60 + os);
+    }
+  }
+  if (p != end)
+    return false;
+
+  auto days = detail::days_from_civil(year, month, day);
+  result.value = static_cast<std::time_t>(days) * SECONDS_PER_DAY +
+                 hour * 3600 + minute * 60 + second - offset;
+  return true;
 }
 
-inline DateTimePtr add_days(const DateTimePtr& dt, int days) {
-  auto tm = std::gmtime(dt.get());
-  tm->tm_mday += 1;
-  auto result = new DateTime();
-  *result = mktime(tm);
-  return DateTimePtr(result);
+inline DateTime from_utcstring(std::string_view dateTime) {
+  DateTime result;
+  if (!try_parse(dateTime, result))
+    throw std::invalid_argument("Invalid timestamp format.");
+  return result;
 }
 
-inline DateTimePtr from_utcstring(const std::string &dateTime) {
-  struct std::tm tm;
-  std::istringstream ss(dateTime);
-  ss >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S %Z");
-  auto dt = new DateTime();
-  *dt = mktime(&tm);
-  return DateTimePtr(dt);
+/*
+    Write "YYYY-MM-DD HH:MM:SS UTC" into buffer, returns pointer past the last
+    written char. Buffer must hold at least UTC_STRING_SIZE chars.
+*/
+inline char *format_utc(char *begin, const DateTime &dt) noexcept {
+  auto days = dt.value / SECONDS_PER_DAY;
+  auto secs = dt.value % SECONDS_PER_DAY;
+  if (secs < 0) {
+    secs += SECONDS_PER_DAY;
+    --days;
+  }
+  auto civil = detail::civil_from_days(days);
+  auto p = detail::write_digits(begin, static_cast<unsigned>(civil.year), 4);
+  *p++ = '-';
+  p = detail::write_digits(p, civil.month, 2);
+  *p++ = '-';
+  p = detail::write_digits(p, civil.day, 2);
+  *p++ = ' ';
+  p = detail::write_digits(p, static_cast<unsigned>(secs / 3600), 2);
+  *p++ = ':';
+  p = detail::write_digits(p, static_cast<unsigned>(secs / 60 % 60), 2);
+  *p++ = ':';
+  p = detail::write_digits(p, static_cast<unsigned>(secs % 60), 2);
+  *p++ = ' ';
+  *p++ = 'U';
+  *p++ = 'T';
+  *p++ = 'C';
+  return p;
 }
 
-inline std::string to_utcstring(const DateTime& dt){
-  auto t = std::chrono::system_clock::from_time_t(dt);
-  return std::format("{:%Y-%m-%d %H:%M:%S %Z}", t);
+inline std::string to_utcstring(const DateTime &dt) {
+  std::string result(UTC_STRING_SIZE, '\0');
+  format_utc(result.data(), dt);
+  return result;
 }
 
-inline std::string to_utcstring(const DateTimePtr& dt){
-  auto t = std::chrono::system_clock::from_time_t(*dt);
-  return std::format("{:%Y-%m-%d %H:%M:%S %Z}", t);
+inline DateTime utc_now() {
+  return DateTime{
+      std::chrono::system_clock::to_time_t(std::chrono::system_clock::now())};
 }
 
+inline std::string utc_now_str() { return to_utcstring(utc_now()); }
+
+inline DateTime add_days(const DateTime &dt, int days) {
+  return DateTime{dt.value + SECONDS_PER_DAY * days};
+}
+
+inline DateTime add_seconds(const DateTime &dt, std::time_t seconds) {
+  return DateTime{dt.value + seconds};
+}
 
 } // namespace datetime
 
-#endif //_CASERV_COMMON_DATETIME_H_
\ No newline at end of file
+#endif //_CASERV_COMMON_DATETIME_H_
@@ -0,0 +1,98 @@
+#ifndef _CASERV_COMMON_HEX_H_
+#define _CASERV_COMMON_HEX_H_
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+    Hex codec of serials and thumbprints. Loops are branch free so the
+    compiler can vectorize them (SSE2 at -O3), encoding is upper case like
+    BN_bn2hex. Odd length is decoded as if left-padded with '0', the same
+    as the bytea migration of stored serials.
+*/
+namespace hex {
+
+// letters of encoded output, digests of other formats are lower case
+enum class Case { Upper, Lower };
+
+namespace detail {
+
+// distance from ':' to 'A' or 'a'
+inline int letter_offset(Case letters) {
+  return letters == Case::Upper ? 'A' - ':' : 'a' - ':';
+}
+
+inline char digit(unsigned nibble, int letterOffset) {
+  // offset moves 10..15 from ':'..'?' to the letters
+  auto letter = ((9 - static_cast<int>(nibble)) >> 8) & letterOffset;
+  return static_cast<char>('0' + nibble + letter);
+}
+
+// value of hex char, sets invalid for other chars
+inline unsigned nibble(unsigned char c, unsigned &invalid) {
+  unsigned isDigit = static_cast<unsigned>(c - '0') < 10;
+  unsigned isLetter = static_cast<unsigned>((c | 0x20) - 'a') < 6;
+  invalid |= (isDigit | isLetter) ^ 1;
+  // digits have bit 6 clear, letters of both cases set it
+  return ((c & 0x0F) + 9 * (c >> 6)) & 0x0F;
+}
+
+} // namespace detail
+
+// dst receives 2 * src.size() chars
+inline void encode(std::span<const std::byte> src, char *dst,
+                   Case letters = Case::Upper) {
+  auto offset = detail::letter_offset(letters);
+  for (std::size_t i = 0; i < src.size(); ++i) {
+    auto value = static_cast<unsigned>(src[i]);
+    dst[2 * i] = detail::digit(value >> 4, offset);
+    dst[2 * i + 1] = detail::digit(value & 0x0F, offset);
+  }
+}
+
+inline std::string encode(std::span<const std::byte> src,
+                          Case letters = Case::Upper) {
+  std::string result(src.size() * 2, '\0');
+  encode(src, result.data(), letters);
+  return result;
+}
+
+inline std::string encode(std::span<const unsigned char> src,
+                          Case letters = Case::Upper) {
+  return encode(std::as_bytes(src), letters);
+}
+
+inline std::size_t decoded_size(std::string_view src) {
+  return (src.size() + 1) / 2;
+}
+
+// dst receives decoded_size(src) bytes, false for not hex char
+inline bool decode(std::string_view src, std::byte *dst) {
+  unsigned invalid = 0;
+  if (src.size() % 2 != 0) {
+    *dst++ = static_cast<std::byte>(
+        detail::nibble(static_cast<unsigned char>(src[0]), invalid));
+    src.remove_prefix(1);
+  }
+  for (std::size_t i = 0; i < src.size() / 2; ++i) {
+    auto high = detail::nibble(static_cast<unsigned char>(src[2 * i]), invalid);
+    auto low = detail::nibble(static_cast<unsigned char>(src[2 * i + 1]), invalid);
+    dst[i] = static_cast<std::byte>((high << 4) | low);
+  }
+  return invalid == 0;
+}
+
+// empty when src is not hex
+inline std::vector<std::byte> decode(std::string_view src) {
+  std::vector<std::byte> result(decoded_size(src));
+  if (!decode(src, result.data()))
+    result.clear();
+  return result;
+}
+
+} // namespace hex
+
+#endif //_CASERV_COMMON_HEX_H_
@@ -1,8 +1,13 @@
 #ifndef _CASERV_COMMON_LOGGER_H_
 #define _CASERV_COMMON_LOGGER_H_
 
+#include <cstddef>
+#include <memory>
+#include <spdlog/async.h>
 #include <spdlog/fmt/fmt.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <string>
 
 #define LOGGER_FORMAT "[%^%l%$] %v"
 #define PROJECT_NAME "caserv"
@@ -14,14 +19,45 @@
 
 #define __FILENAME__ (static_cast<const char *>(__FILE__) + ROOT_PATH_SIZE)
 
-#define LOG_INFO(...) spdlog::info(__VA_ARGS__);
-#define LOG_WARNING(...) spdlog::warn(__VA_ARGS__);
-#define LOG_DEBUG(...) spdlog::debug(__VA_ARGS__);
+// arguments are not evaluated nor formatted when level is disabled
+#define LOG_AT(level, ...)                                                     \
+  do {                                                                         \
+    if (spdlog::should_log(level))                                             \
+      spdlog::log(level, __VA_ARGS__);                                         \
+  } while (0)
+
+#define LOG_INFO(...) LOG_AT(spdlog::level::info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(spdlog::level::warn, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(spdlog::level::debug, __VA_ARGS__)
 
 #if !defined(NDEBUG) || defined(DEBUG) || defined(_DEBUG)
-#	define LOG_ERROR(...) spdlog::error("[{}:{}] {}", __FILENAME__, __LINE__, fmt::format(__VA_ARGS__));
+#	define LOG_ERROR(...) LOG_AT(spdlog::level::err, "[{}:{}] {}", __FILENAME__, __LINE__, fmt::format(__VA_ARGS__))
 #else
-#	define LOG_ERROR(...) spdlog::error(__VA_ARGS__);
+#	define LOG_ERROR(...) LOG_AT(spdlog::level::err, __VA_ARGS__)
 #endif
 
-#endif //_CASERV_COMMON_LOGGER_H_
\ No newline at end of file
+namespace logger {
+
+/*
+    Replace default logger with async console logger. Messages are formatted
+    on the calling thread and written by a background thread. When the queue
+    is full callers either wait (block) or overwrite the oldest queued
+    message (drop).
+*/
+inline void init_async(const std::string &level, std::size_t queueSize,
+                       bool dropOnOverflow) {
+  spdlog::init_thread_pool(queueSize, 1);
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto logger = std::make_shared<spdlog::async_logger>(
+      PROJECT_NAME, sink, spdlog::thread_pool(),
+      dropOnOverflow ? spdlog::async_overflow_policy::overrun_oldest
+                     : spdlog::async_overflow_policy::block);
+  logger->set_level(spdlog::level::from_str(level));
+  // errors are flushed at once, the rest by background thread
+  logger->flush_on(spdlog::level::err);
+  spdlog::set_default_logger(logger);
+}
+
+} // namespace logger
+
+#endif //_CASERV_COMMON_LOGGER_H_
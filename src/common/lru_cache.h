@@ -0,0 +1,113 @@
+#ifndef _CASERV_COMMON_LRU_CACHE_H_
+#define _CASERV_COMMON_LRU_CACHE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace common {
+
+/*
+    Thread safe LRU map with per entry expiration. Least recently used entry
+    is evicted when capacity is reached, capacity 0 disables the cache.
+    Generation changes on every Erase and Clear; a value loaded before an
+    invalidation is not put back when Put gets the generation read before
+    the load.
+*/
+template <typename TKey, typename TValue> class LruCache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit LruCache(std::size_t capacity) : _capacity(capacity) {}
+  LruCache(const LruCache &) = delete;
+  LruCache &operator=(const LruCache &) = delete;
+
+  std::optional<TValue> Get(const TKey &key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(key);
+    if (it == _index.end())
+      return std::nullopt;
+    if (it->second->expires <= Clock::now()) {
+      _entries.erase(it->second);
+      _index.erase(it);
+      return std::nullopt;
+    }
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return it->second->value;
+  }
+
+  std::uint64_t Generation() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _generation;
+  }
+
+  // skipped when entries were invalidated after generation was read
+  void Put(const TKey &key, TValue value, Clock::duration ttl,
+           std::optional<std::uint64_t> generation = std::nullopt) {
+    if (_capacity == 0 || ttl <= Clock::duration::zero())
+      return;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (generation && *generation != _generation)
+      return;
+    auto expires = Clock::now() + ttl;
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+      it->second->value = std::move(value);
+      it->second->expires = expires;
+      _entries.splice(_entries.begin(), _entries, it->second);
+      return;
+    }
+    if (_index.size() >= _capacity) {
+      _index.erase(_entries.back().key);
+      _entries.pop_back();
+    }
+    _entries.push_front(Entry{key, std::move(value), expires});
+    _index.emplace(key, _entries.begin());
+  }
+
+  void Erase(const TKey &key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // a load in progress may predate the change even if key is not cached
+    ++_generation;
+    auto it = _index.find(key);
+    if (it == _index.end())
+      return;
+    _entries.erase(it->second);
+    _index.erase(it);
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _index.clear();
+    _entries.clear();
+  }
+
+  std::size_t Size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _index.size();
+  }
+
+private:
+  struct Entry {
+    TKey key;
+    TValue value;
+    Clock::time_point expires;
+  };
+
+  std::size_t _capacity;
+  // most recently used first
+  std::list<Entry> _entries;
+  std::unordered_map<TKey, typename std::list<Entry>::iterator> _index;
+  std::uint64_t _generation{0};
+  mutable std::mutex _mutex;
+};
+
+} // namespace common
+
+#endif //_CASERV_COMMON_LRU_CACHE_H_
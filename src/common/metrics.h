@@ -0,0 +1,261 @@
+#ifndef _CASERV_COMMON_METRICS_H_
+#define _CASERV_COMMON_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+namespace detail {
+
+// counters are striped, a thread always updates the same stripe
+constexpr std::size_t STRIPES = 16;
+
+inline std::size_t stripe() {
+  thread_local const std::size_t index =
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) % STRIPES;
+  return index;
+}
+
+inline std::string format_labels(const Labels &labels,
+                                 const std::string &extra = "") {
+  std::string result;
+  for (const auto &[name, value] : labels) {
+    result += result.empty() ? "{" : ",";
+    result += fmt::format("{}=\"{}\"", name, value);
+  }
+  if (!extra.empty()) {
+    result += result.empty() ? "{" : ",";
+    result += extra;
+  }
+  if (!result.empty())
+    result += "}";
+  return result;
+}
+
+} // namespace detail
+
+class Counter {
+public:
+  void Increment(std::uint64_t value = 1) {
+    _stripes[detail::stripe()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  std::uint64_t Value() const {
+    std::uint64_t result = 0;
+    for (const auto &stripe : _stripes)
+      result += stripe.value.load(std::memory_order_relaxed);
+    return result;
+  }
+
+private:
+  struct alignas(64) Stripe {
+    std::atomic<std::uint64_t> value{0};
+  };
+  std::array<Stripe, detail::STRIPES> _stripes;
+};
+
+/*
+    Latency histogram with HDR-like log-linear buckets over microseconds:
+    8 linear sub-buckets per power of two, ~12% relative error, up to ~2 min.
+    Record is a few relaxed atomic adds on the calling thread stripe.
+*/
+class Histogram {
+public:
+  static constexpr std::size_t SUB_BUCKETS = 8;
+  static constexpr std::size_t BUCKETS = 200;
+
+  void Record(std::chrono::nanoseconds duration) {
+    auto us = static_cast<std::uint64_t>(
+        std::max<std::int64_t>(duration.count() / 1000, 0));
+    auto &stripe = _stripes[detail::stripe()];
+    stripe.buckets[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    stripe.sumUs.fetch_add(us, std::memory_order_relaxed);
+  }
+
+  static std::size_t BucketIndex(std::uint64_t us) {
+    if (us < SUB_BUCKETS)
+      return us;
+    auto msb = static_cast<std::size_t>(std::bit_width(us) - 1);
+    auto sub = (us >> (msb - 3)) & (SUB_BUCKETS - 1);
+    return std::min((msb - 2) * SUB_BUCKETS + sub, BUCKETS - 1);
+  }
+
+  // exclusive upper bound of bucket in microseconds
+  static std::uint64_t BucketLimit(std::size_t index) {
+    if (index < SUB_BUCKETS)
+      return index + 1;
+    auto msb = index / SUB_BUCKETS + 2;
+    auto sub = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub + 1) << (msb - 3);
+  }
+
+  struct Snapshot {
+    std::array<std::uint64_t, BUCKETS> buckets{};
+    std::uint64_t count{0};
+    std::uint64_t sumUs{0};
+  };
+
+  Snapshot Collect() const {
+    Snapshot result;
+    for (const auto &stripe : _stripes) {
+      for (std::size_t i = 0; i < BUCKETS; ++i) {
+        auto value = stripe.buckets[i].load(std::memory_order_relaxed);
+        result.buckets[i] += value;
+        result.count += value;
+      }
+      result.sumUs += stripe.sumUs.load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+private:
+  struct alignas(64) Stripe {
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets{};
+    std::atomic<std::uint64_t> sumUs{0};
+  };
+  std::array<Stripe, detail::STRIPES> _stripes;
+};
+
+/*
+    Records time from construction to destruction.
+*/
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Histogram &histogram)
+      : _histogram(histogram), _start(std::chrono::steady_clock::now()) {}
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+  ~ScopedTimer() {
+    _histogram.Record(std::chrono::steady_clock::now() - _start);
+  }
+
+private:
+  Histogram &_histogram;
+  std::chrono::steady_clock::time_point _start;
+};
+
+/*
+    Process wide metric set. Metrics are created once (function local
+    statics at the call site) and never removed, returned references stay
+    valid for the process lifetime.
+*/
+class Registry {
+public:
+  static Registry &Instance() {
+    static Registry registry;
+    return registry;
+  }
+
+  Counter &GetCounter(const std::string &name, const std::string &help,
+                      const Labels &labels = {}) {
+    return Get(_counters, name, help, labels);
+  }
+
+  Histogram &GetHistogram(const std::string &name, const std::string &help,
+                          const Labels &labels = {}) {
+    return Get(_histograms, name, help, labels);
+  }
+
+  // Prometheus text exposition format, histograms in seconds
+  std::string Serialize() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string result;
+    for (const auto &[name, family] : _counters) {
+      result += fmt::format("# HELP {} {}\n# TYPE {} counter\n", name,
+                            family.help, name);
+      for (const auto &[labels, counter] : family.metrics)
+        result += fmt::format("{}{} {}\n", name, detail::format_labels(labels),
+                              counter->Value());
+    }
+    for (const auto &[name, family] : _histograms) {
+      result += fmt::format("# HELP {} {}\n# TYPE {} histogram\n", name,
+                            family.help, name);
+      for (const auto &[labels, histogram] : family.metrics)
+        SerializeHistogram(result, name, labels, histogram->Collect());
+    }
+    return result;
+  }
+
+private:
+  template <typename TMetric> struct Family {
+    std::string help;
+    std::map<Labels, std::unique_ptr<TMetric>> metrics;
+  };
+  template <typename TMetric>
+  using Families = std::map<std::string, Family<TMetric>>;
+
+  Registry() = default;
+
+  template <typename TMetric>
+  TMetric &Get(Families<TMetric> &families, const std::string &name,
+               const std::string &help, const Labels &labels) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto &family = families[name];
+    if (family.help.empty())
+      family.help = help;
+    auto &metric = family.metrics[labels];
+    if (metric == nullptr)
+      metric = std::make_unique<TMetric>();
+    return *metric;
+  }
+
+  static void SerializeHistogram(std::string &result, const std::string &name,
+                                 const Labels &labels,
+                                 const Histogram::Snapshot &snapshot) {
+    // exported bounds are powers of two microseconds, 16 us .. ~33 s,
+    // they fall on bucket boundaries so counts are exact
+    std::size_t index = 0;
+    std::uint64_t cumulative = 0;
+    for (std::uint64_t limit = 16; limit <= (1ull << 25); limit <<= 1) {
+      while (index < Histogram::BUCKETS &&
+             Histogram::BucketLimit(index) <= limit)
+        cumulative += snapshot.buckets[index++];
+      result += fmt::format(
+          "{}_bucket{} {}\n", name,
+          detail::format_labels(labels, fmt::format("le=\"{:g}\"", limit / 1e6)),
+          cumulative);
+    }
+    result += fmt::format("{}_bucket{} {}\n", name,
+                          detail::format_labels(labels, "le=\"+Inf\""),
+                          snapshot.count);
+    result += fmt::format("{}_sum{} {:g}\n", name, detail::format_labels(labels),
+                          snapshot.sumUs / 1e6);
+    result += fmt::format("{}_count{} {}\n", name, detail::format_labels(labels),
+                          snapshot.count);
+  }
+
+  Families<Counter> _counters;
+  Families<Histogram> _histograms;
+  mutable std::mutex _mutex;
+};
+
+inline Counter &counter(const std::string &name, const std::string &help,
+                        const Labels &labels = {}) {
+  return Registry::Instance().GetCounter(name, help, labels);
+}
+
+inline Histogram &histogram(const std::string &name, const std::string &help,
+                            const Labels &labels = {}) {
+  return Registry::Instance().GetHistogram(name, help, labels);
+}
+
+} // namespace metrics
+
+#endif //_CASERV_COMMON_METRICS_H_
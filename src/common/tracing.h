@@ -0,0 +1,271 @@
+#ifndef _CASERV_COMMON_TRACING_H_
+#define _CASERV_COMMON_TRACING_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace tracing {
+
+/*
+    Span names are string literals, spans of one request are collected on
+    the handling thread without locks. Times are unix nanoseconds.
+*/
+struct Span {
+  std::uint64_t spanId{0};
+  // 0 - root span
+  std::uint64_t parentId{0};
+  const char *name{nullptr};
+  std::uint64_t startNs{0};
+  std::uint64_t endNs{0};
+  bool error{false};
+};
+
+struct Trace {
+  std::array<std::uint64_t, 2> traceId{};
+  std::vector<Span> spans;
+};
+
+namespace detail {
+
+inline std::uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+inline std::uint64_t next_id() {
+  thread_local std::mt19937_64 engine{std::random_device{}()};
+  std::uint64_t id = 0;
+  while (id == 0)
+    id = engine();
+  return id;
+}
+
+// trace of the request handled by this thread, null when not sampled
+inline thread_local Trace *current = nullptr;
+inline thread_local std::uint64_t currentSpan = 0;
+
+} // namespace detail
+
+/*
+    Keeps traces of slow or failed requests in a bounded ring buffer, the
+    oldest trace is dropped when it is full. Disabled until configured.
+*/
+class Tracer {
+public:
+  static Tracer &Instance() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  void Configure(std::size_t capacity, std::chrono::milliseconds slowThreshold) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _capacity = capacity;
+    _slowThresholdNs = std::chrono::nanoseconds(slowThreshold).count();
+    _enabled.store(capacity > 0, std::memory_order_release);
+  }
+
+  bool Enabled() const { return _enabled.load(std::memory_order_acquire); }
+
+  // tail sampling, decided after the request completed
+  void Submit(Trace &&trace, std::uint64_t durationNs, bool error) {
+    if (!error && durationNs < _slowThresholdNs)
+      return;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_traces.size() >= _capacity) {
+      _traces.pop_front();
+      ++_dropped;
+    }
+    _traces.push_back(std::move(trace));
+  }
+
+  std::deque<Trace> Drain() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::exchange(_traces, {});
+  }
+
+  std::uint64_t Dropped() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _dropped;
+  }
+
+private:
+  Tracer() = default;
+
+  std::atomic<bool> _enabled{false};
+  std::size_t _capacity{0};
+  std::uint64_t _slowThresholdNs{0};
+  std::uint64_t _dropped{0};
+  std::deque<Trace> _traces;
+  mutable std::mutex _mutex;
+};
+
+/*
+    Root span of a request, makes the trace current for the thread.
+    Nothing is recorded when tracing is disabled.
+*/
+class RequestTrace {
+public:
+  explicit RequestTrace(const char *name) {
+    if (!Tracer::Instance().Enabled() || detail::current != nullptr)
+      return;
+    _trace.traceId = {detail::next_id(), detail::next_id()};
+    _trace.spans.reserve(16);
+    _trace.spans.push_back(Span{.spanId = detail::next_id(),
+                                .name = name,
+                                .startNs = detail::now_ns()});
+    detail::current = &_trace;
+    detail::currentSpan = _trace.spans.front().spanId;
+    _active = true;
+  }
+  RequestTrace(const RequestTrace &) = delete;
+  RequestTrace &operator=(const RequestTrace &) = delete;
+
+  ~RequestTrace() {
+    if (!_active)
+      return;
+    detail::current = nullptr;
+    detail::currentSpan = 0;
+    auto &root = _trace.spans.front();
+    root.endNs = detail::now_ns();
+    root.error = _error;
+    auto duration = root.endNs - root.startNs;
+    Tracer::Instance().Submit(std::move(_trace), duration, _error);
+  }
+
+  void Fail() { _error = true; }
+
+private:
+  Trace _trace;
+  bool _active{false};
+  bool _error{false};
+};
+
+/*
+    Child span of the current span, marked failed when left by exception.
+*/
+class ScopedSpan {
+public:
+  explicit ScopedSpan(const char *name) {
+    if (detail::current == nullptr)
+      return;
+    _span = Span{.spanId = detail::next_id(),
+                 .parentId = detail::currentSpan,
+                 .name = name,
+                 .startNs = detail::now_ns()};
+    _exceptions = std::uncaught_exceptions();
+    detail::currentSpan = _span.spanId;
+  }
+  ScopedSpan(const ScopedSpan &) = delete;
+  ScopedSpan &operator=(const ScopedSpan &) = delete;
+
+  ~ScopedSpan() {
+    if (_span.spanId == 0 || detail::current == nullptr)
+      return;
+    _span.endNs = detail::now_ns();
+    _span.error = std::uncaught_exceptions() > _exceptions;
+    detail::currentSpan = _span.parentId;
+    detail::current->spans.push_back(_span);
+  }
+
+private:
+  Span _span;
+  int _exceptions{0};
+};
+
+/*
+    OTLP/JSON ExportTraceServiceRequest, one line per export.
+*/
+inline std::string to_otlp_json(const std::deque<Trace> &traces,
+                                const std::string &serviceName) {
+  std::string spans;
+  for (const auto &trace : traces) {
+    auto traceId = fmt::format("{:016x}{:016x}", trace.traceId[0], trace.traceId[1]);
+    for (const auto &span : trace.spans) {
+      if (!spans.empty())
+        spans += ',';
+      spans += fmt::format(
+          R"({{"traceId":"{}","spanId":"{:016x}",{}"name":"{}","kind":{},)"
+          R"("startTimeUnixNano":"{}","endTimeUnixNano":"{}",)"
+          R"("status":{{"code":{}}}}})",
+          traceId, span.spanId,
+          span.parentId == 0
+              ? std::string()
+              : fmt::format(R"("parentSpanId":"{:016x}",)", span.parentId),
+          span.name, span.parentId == 0 ? 2 : 1, span.startNs, span.endNs,
+          span.error ? 2 : 1);
+    }
+  }
+  return fmt::format(
+      R"({{"resourceSpans":[{{"resource":{{"attributes":[{{"key":"service.name",)"
+      R"("value":{{"stringValue":"{}"}}}}]}},"scopeSpans":[{{"scope":{{"name":"{}"}},)"
+      R"("spans":[{}]}}]}}]}})",
+      serviceName, serviceName, spans);
+}
+
+/*
+    Appends sampled traces to file periodically, OTLP file exporter layout
+    (JSON lines).
+*/
+class FileExporter {
+public:
+  FileExporter(const std::string &path, std::chrono::seconds interval,
+               const std::string &serviceName)
+      : _path(path), _interval(interval), _serviceName(serviceName),
+        _thread([this] { Run(); }) {}
+  FileExporter(const FileExporter &) = delete;
+  FileExporter &operator=(const FileExporter &) = delete;
+
+  ~FileExporter() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _condition.notify_one();
+    _thread.join();
+  }
+
+private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+      _condition.wait_for(lock, _interval, [this] { return _stop; });
+      Export();
+    }
+  }
+
+  void Export() {
+    auto traces = Tracer::Instance().Drain();
+    if (traces.empty())
+      return;
+    std::ofstream file(_path, std::ios::app);
+    file << to_otlp_json(traces, _serviceName) << '\n';
+  }
+
+  std::string _path;
+  std::chrono::seconds _interval;
+  std::string _serviceName;
+  bool _stop{false};
+  std::mutex _mutex;
+  std::condition_variable _condition;
+  std::thread _thread;
+};
+
+} // namespace tracing
+
+#endif //_CASERV_COMMON_TRACING_H_
@@ -8,7 +8,10 @@
 namespace contracts {
 
 struct CaInfo {
+  std::string serial;
   std::vector<std::string> crlDistributionPoints;
+  // CDP of CRL partition i + 1, empty - CRL is not partitioned
+  std::vector<std::string> crlPartitionDistributionPoints;
   std::vector<std::string> ocspEndPoints;
   std::vector<std::string> caEndPoints;
   std::vector<std::byte> privateKey;
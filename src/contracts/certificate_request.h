@@ -3,7 +3,9 @@
 
 #include "enums.h"
 #include "./../common/datetime.h"
+#include <cstddef>
 #include <cstdint>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -20,6 +22,10 @@ using namespace datetime;
         std::string_view emailAddress;
         uint16_t ttlInDays{365};
         std::string_view pin;
+        // issuance profile name, empty - default profile
+        std::string_view profile;
+        // CRL partition named in CDP, 0 - full CRL of CA
+        std::int32_t crlPartition{0};
     };
 
     struct PhysicalPersonCertificateRequest : public CertificateRequestBase {
@@ -44,15 +50,18 @@ using namespace datetime;
     typedef JuridicalPersonCertificateRequest CertificateRequest;
 
     struct CrlEntry {
-        std::string serialNumber;
-        DateTimePtr revokationDate;
+        // serial bytes, owned by the caller until GenerateCrl returns
+        std::span<const std::byte> serialNumber;
+        DateTime revokationDate;
     };
 
     struct CrlRequest {
         long number;
+        // partitioned CRL gets Issuing Distribution Point, 0 - full CRL
+        std::int32_t partition{0};
         std::vector<CrlEntry> entries;
-        DateTimePtr issueDate;
-        DateTimePtr expireDate;
+        DateTime issueDate;
+        DateTime expireDate;
     };
 
 } // namespace contracts
@@ -1,6 +1,7 @@
 #ifndef _CASERV_CONTRACTS_GENERATED_CERTIFICATE_H_
 #define _CASERV_CONTRACTS_GENERATED_CERTIFICATE_H_
 
+#include "./../common/datetime.h"
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -13,6 +14,9 @@ namespace contracts {
         std::vector<std::byte> container;
         std::string serialNumber;
         std::string thumbprint;
+        datetime::DateTime notAfter;
+        // pfx or pem, depends on profile container format
+        std::string fileExtension{"pfx"};
     };
 
     struct Certificate {
@@ -20,6 +24,7 @@ namespace contracts {
         std::vector<std::byte> certificate;
         std::string serialNumber;
         std::string thumbprint;
+        datetime::DateTime notAfter;
     };
 
     struct Crl {
@@ -0,0 +1,210 @@
+#include "caching_database.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace db;
+
+// serials are compared case insensitive by database queries
+static std::string Key(const std::string_view &serial) {
+  std::string key(serial);
+  std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+  return key;
+}
+
+// CRL entries are cached per CA partition
+static std::string CrlKey(const std::string_view &caSerial,
+                          std::int32_t partition) {
+  return Key(caSerial) + ":" + std::to_string(partition);
+}
+
+template <typename T> static bool Found(const std::shared_ptr<T> &value) {
+  return value != nullptr;
+}
+
+static bool Found(const std::shared_ptr<const std::vector<std::byte>> &value) {
+  return value != nullptr && !value->empty();
+}
+
+template <typename TValue, typename TLoad>
+static TValue GetOrLoad(common::LruCache<std::string, TValue> &cache,
+                        const std::string &key, std::chrono::seconds ttl,
+                        std::chrono::seconds negativeTtl, TLoad &&load) {
+  if (auto cached = cache.Get(key))
+    return *cached;
+  // invalidation during the load may not be reflected in value
+  auto generation = cache.Generation();
+  TValue value = load();
+  cache.Put(key, value, Found(value) ? ttl : negativeTtl, generation);
+  return value;
+}
+
+CachingDataBase::CachingDataBase(IDataBasePtr db, const CachingOptions &options)
+    : _db(db), _options(options), _certificates(options.capacity),
+      _ca(options.capacity), _caMetadata(options.capacity),
+      _caCertificates(options.capacity), _crl(options.capacity),
+      _lastRevoked(options.capacity) {}
+
+CachingDataBase::~CachingDataBase() {}
+
+CertificateModelPtr CachingDataBase::GetCertificate(const std::string &serial) {
+  return GetOrLoad(_certificates, Key(serial), _options.certificateTtl,
+                   _options.negativeTtl,
+                   [&] { return _db->GetCertificate(serial); });
+}
+
+std::vector<CertificateModelPtr>
+CachingDataBase::GetCertificates(const std::string &caSerial) {
+  return _db->GetCertificates(caSerial);
+}
+
+std::vector<CertificateModelPtr> CachingDataBase::GetAllCertificates() {
+  return _db->GetAllCertificates();
+}
+
+CertificateAuthorityModelPtr CachingDataBase::GetCa(const std::string &serial) {
+  auto ca = GetOrLoad(_ca, Key(serial), _options.caTtl, _options.negativeTtl,
+                      [&]() -> CaModelPtr { return _db->GetCa(serial); });
+  if (ca == nullptr)
+    return nullptr;
+  // callers take ownership of key material, hand out a copy
+  return std::make_shared<CertificateAuthorityModel>(*ca);
+}
+
+CertificateAuthorityMetadataModelPtr
+CachingDataBase::GetCaMetadata(const std::string &serial) {
+  return GetOrLoad(_caMetadata, Key(serial), _options.caTtl,
+                   _options.negativeTtl,
+                   [&] { return _db->GetCaMetadata(serial); });
+}
+
+std::vector<CertificateAuthorityMetadataModelPtr> CachingDataBase::GetAllCa() {
+  return _db->GetAllCa();
+}
+
+std::vector<std::byte>
+CachingDataBase::GetCaCertificateData(const std::string &serial) {
+  auto data = GetOrLoad(
+      _caCertificates, Key(serial), _options.caTtl, _options.negativeTtl,
+      [&] {
+        return std::make_shared<const std::vector<std::byte>>(
+            _db->GetCaCertificateData(serial));
+      });
+  return *data;
+}
+
+void CachingDataBase::AddCertificate(const CertificateModel &cert) {
+  _db->AddCertificate(cert);
+  _certificates.Erase(Key(cert.serial));
+}
+
+void CachingDataBase::AddCA(const CertificateAuthorityModel &ca) {
+  _db->AddCA(ca);
+  auto key = Key(ca.serial);
+  _ca.Erase(key);
+  _caMetadata.Erase(key);
+  _caCertificates.Erase(key);
+}
+
+void CachingDataBase::MakeCertificateRevoked(const std::string &serial,
+                                             const DateTime revokeDate) {
+  // CA and partition never change, cached row names them; the revoking
+  // caller has just loaded it
+  auto cert = GetCertificate(serial);
+  _db->MakeCertificateRevoked(serial, revokeDate);
+  _certificates.Erase(Key(serial));
+  if (cert == nullptr) {
+    _lastRevoked.Clear();
+    return;
+  }
+  _lastRevoked.Erase(CrlKey(cert->caSerial, 0));
+  _lastRevoked.Erase(CrlKey(cert->caSerial, cert->crlPartition));
+}
+
+std::vector<CertificateModelPtr>
+CachingDataBase::GetRevokedListOrderByRevokeDateDesc(
+    const std::string &caSerial, std::int32_t partition,
+    const DateTime &validAt) {
+  return _db->GetRevokedListOrderByRevokeDateDesc(caSerial, partition,
+                                                  validAt);
+}
+
+CertificateModelPtr
+CachingDataBase::GetLastRevoked(const std::string &caSerial,
+                                std::int32_t partition) {
+  return GetOrLoad(_lastRevoked, CrlKey(caSerial, partition), _options.crlTtl,
+                   _options.crlTtl,
+                   [&] { return _db->GetLastRevoked(caSerial, partition); });
+}
+
+void CachingDataBase::AddCrl(const CrlModel &crl) {
+  _db->AddCrl(crl);
+  _crl.Erase(CrlKey(crl.caSerial, crl.partition));
+}
+
+CrlModelPtr CachingDataBase::GetActualCrl(const std::string &caSerial,
+                                          std::int32_t partition) {
+  return GetOrLoad(_crl, CrlKey(caSerial, partition), _options.crlTtl,
+                   _options.negativeTtl,
+                   [&] { return _db->GetActualCrl(caSerial, partition); });
+}
+
+bool CachingDataBase::TryWithCrlLock(const std::string &caSerial,
+                                     std::int32_t partition,
+                                     std::chrono::milliseconds wait,
+                                     const std::function<void()> &generate) {
+  return _db->TryWithCrlLock(caSerial, partition, wait, generate);
+}
+
+void CachingDataBase::Invalidate(const Invalidation &invalidation) {
+  auto key = Key(invalidation.serial);
+  switch (invalidation.type) {
+  case InvalidationType::Ca:
+    _ca.Erase(key);
+    _caMetadata.Erase(key);
+    _caCertificates.Erase(key);
+    break;
+  case InvalidationType::Crl:
+    _crl.Erase(CrlKey(key, invalidation.partition));
+    break;
+  case InvalidationType::Revoked:
+    _certificates.Erase(key);
+    // full CRL covers every partition
+    _lastRevoked.Erase(CrlKey(invalidation.caSerial, 0));
+    _lastRevoked.Erase(CrlKey(invalidation.caSerial, invalidation.partition));
+    break;
+  }
+}
+
+void CachingDataBase::Clear() {
+  _certificates.Clear();
+  _ca.Clear();
+  _caMetadata.Clear();
+  _caCertificates.Clear();
+  _crl.Clear();
+  _lastRevoked.Clear();
+}
+
+bool CachingDataBase::ClaimIdempotencyKey(const IdempotencyModel &model) {
+  return _db->ClaimIdempotencyKey(model);
+}
+
+IdempotencyModelPtr CachingDataBase::GetIdempotencyKey(const std::string &key) {
+  // pending keys change under other instances, never cached
+  return _db->GetIdempotencyKey(key);
+}
+
+void CachingDataBase::CompleteIdempotencyKey(const IdempotencyModel &model) {
+  _db->CompleteIdempotencyKey(model);
+}
+
+void CachingDataBase::DeleteIdempotencyKey(const std::string &key) {
+  _db->DeleteIdempotencyKey(key);
+}
+
+void CachingDataBase::DeleteExpiredIdempotencyKeys(const DateTime &now) {
+  _db->DeleteExpiredIdempotencyKeys(now);
+}
@@ -0,0 +1,94 @@
+#ifndef _CASERV_DB_CACHING_DATABASE_H_
+#define _CASERV_DB_CACHING_DATABASE_H_
+
+#include "./../common/lru_cache.h"
+#include "idatabase.h"
+#include "invalidation.h"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace db {
+
+struct CachingOptions {
+  // entries per cached method
+  std::size_t capacity{10000};
+  std::chrono::seconds caTtl{3600};
+  std::chrono::seconds certificateTtl{60};
+  std::chrono::seconds crlTtl{60};
+  // not found results, keeps unknown serials from reaching database
+  std::chrono::seconds negativeTtl{5};
+};
+
+/*
+    Read-through cache in front of another IDataBase. Single row lookups
+    (CA, CA certificate, certificate, actual CRL, last revoked) are cached,
+    list queries go to the wrapped database. Write methods invalidate
+    affected entries of this instance, writes of other instances are
+    applied by Invalidate when they are delivered (PqListener).
+*/
+class CachingDataBase : public IDataBase {
+public:
+  CachingDataBase(IDataBasePtr db, const CachingOptions &options = {});
+  ~CachingDataBase();
+
+  CertificateModelPtr GetCertificate(const std::string &serial) override;
+  std::vector<CertificateModelPtr>
+  GetCertificates(const std::string &caSerial) override;
+  std::vector<CertificateModelPtr> GetAllCertificates() override;
+  CertificateAuthorityModelPtr GetCa(const std::string &serial) override;
+  CertificateAuthorityMetadataModelPtr
+  GetCaMetadata(const std::string &serial) override;
+  std::vector<CertificateAuthorityMetadataModelPtr> GetAllCa() override;
+  std::vector<std::byte> GetCaCertificateData(const std::string &serial) override;
+  void AddCertificate(const CertificateModel &cert) override;
+  void AddCA(const CertificateAuthorityModel &ca) override;
+
+  void MakeCertificateRevoked(const std::string &serial,
+                              const DateTime revokeDate) override;
+  std::vector<CertificateModelPtr>
+  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                      std::int32_t partition,
+                                      const DateTime &validAt) override;
+  CertificateModelPtr GetLastRevoked(const std::string &caSerial,
+                                     std::int32_t partition) override;
+
+  void AddCrl(const CrlModel &crl) override;
+  CrlModelPtr GetActualCrl(const std::string &caSerial,
+                           std::int32_t partition) override;
+  bool TryWithCrlLock(const std::string &caSerial, std::int32_t partition,
+                      std::chrono::milliseconds wait,
+                      const std::function<void()> &generate) override;
+  bool ClaimIdempotencyKey(const IdempotencyModel &model) override;
+  IdempotencyModelPtr GetIdempotencyKey(const std::string &key) override;
+  void CompleteIdempotencyKey(const IdempotencyModel &model) override;
+  void DeleteIdempotencyKey(const std::string &key) override;
+  void DeleteExpiredIdempotencyKeys(const DateTime &now) override;
+
+  void Invalidate(const Invalidation &invalidation);
+  // drop all entries, changes may have been missed
+  void Clear();
+
+private:
+  template <typename TValue>
+  using Cache = common::LruCache<std::string, TValue>;
+  using CaCertificateData = std::shared_ptr<const std::vector<std::byte>>;
+  using CaModelPtr = std::shared_ptr<const CertificateAuthorityModel>;
+
+  IDataBasePtr _db;
+  CachingOptions _options;
+  Cache<CertificateModelPtr> _certificates;
+  Cache<CaModelPtr> _ca;
+  Cache<CertificateAuthorityMetadataModelPtr> _caMetadata;
+  Cache<CaCertificateData> _caCertificates;
+  Cache<CrlModelPtr> _crl;
+  Cache<CertificateModelPtr> _lastRevoked;
+};
+
+using CachingDataBasePtr = std::shared_ptr<CachingDataBase>;
+
+} // namespace db
+
+#endif //_CASERV_DB_CACHING_DATABASE_H_
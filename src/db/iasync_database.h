@@ -0,0 +1,60 @@
+#ifndef _CASERV_DB_IASYNC_DATABASE_H_
+#define _CASERV_DB_IASYNC_DATABASE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "models/models.h"
+
+namespace db {
+
+using namespace models;
+
+/*
+    Non-blocking variant of IDataBase. Calls return at once, the query is
+    completed by the database event loop and the future becomes ready with
+    the result or the query error.
+*/
+class IAsyncDataBase {
+public:
+  virtual ~IAsyncDataBase() = default;
+  virtual std::future<void> AddCertificateAsync(const CertificateModel &cert) = 0;
+  virtual std::future<CertificateModelPtr>
+  GetCertificateAsync(const std::string &serial) = 0;
+  virtual std::future<std::vector<CertificateModelPtr>>
+  GetCertificatesAsync(const std::string &caSerial) = 0;
+  virtual std::future<std::vector<CertificateModelPtr>> GetAllCertificatesAsync() = 0;
+
+  virtual std::future<void> AddCAAsync(const CertificateAuthorityModel &ca) = 0;
+  virtual std::future<CertificateAuthorityModelPtr>
+  GetCaAsync(const std::string &serial) = 0;
+  virtual std::future<CertificateAuthorityMetadataModelPtr>
+  GetCaMetadataAsync(const std::string &serial) = 0;
+  virtual std::future<std::vector<CertificateAuthorityMetadataModelPtr>>
+  GetAllCaAsync() = 0;
+  virtual std::future<std::vector<std::byte>>
+  GetCaCertificateDataAsync(const std::string &serial) = 0;
+
+  virtual std::future<void> AddCrlAsync(const CrlModel &crl) = 0;
+  virtual std::future<CrlModelPtr>
+  GetActualCrlAsync(const std::string &caSerial, std::int32_t partition) = 0;
+
+  virtual std::future<void> MakeCertificateRevokedAsync(const std::string &serial,
+                                                        const DateTime revokeDate) = 0;
+  virtual std::future<std::vector<CertificateModelPtr>>
+  GetRevokedListOrderByRevokeDateDescAsync(const std::string &caSerial,
+                                           std::int32_t partition,
+                                           const DateTime &validAt) = 0;
+  virtual std::future<CertificateModelPtr>
+  GetLastRevokedAsync(const std::string &caSerial, std::int32_t partition) = 0;
+};
+
+using IAsyncDataBasePtr = std::shared_ptr<IAsyncDataBase>;
+
+} // namespace db
+
+#endif //_CASERV_DB_IASYNC_DATABASE_H_
@@ -1,7 +1,10 @@
 #ifndef _CASERV_DB_IDATABASE_H_
 #define _CASERV_DB_IDATABASE_H_
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -22,18 +25,47 @@ public:
   virtual std::vector<CertificateModelPtr> GetAllCertificates() = 0;
 
   virtual void AddCA(const CertificateAuthorityModel &ca) = 0;
+  // full CA row including certificate and private key, signing path only
   virtual CertificateAuthorityModelPtr GetCa(const std::string &serial) = 0;
-  virtual std::vector<CertificateAuthorityModelPtr> GetAllCa() = 0;
+  virtual CertificateAuthorityMetadataModelPtr
+  GetCaMetadata(const std::string &serial) = 0;
+  virtual std::vector<CertificateAuthorityMetadataModelPtr> GetAllCa() = 0;
   virtual std::vector<std::byte> GetCaCertificateData(const std::string &serial) = 0;
 
+  // CRL methods take partition, 0 - full CRL covering all certificates
   virtual void AddCrl(const CrlModel &crl) = 0;
-  virtual CrlModelPtr GetActualCrl(const std::string &caSerial) = 0;
+  virtual CrlModelPtr GetActualCrl(const std::string &caSerial,
+                                   std::int32_t partition) = 0;
 
   virtual void MakeCertificateRevoked(const std::string &serial,
-                                      const DateTimePtr revokeDate) = 0;
+                                      const DateTime revokeDate) = 0;
+  // certificates expired before validAt are skipped, CRL lists only
+  // revocations of certificates that are still valid; rows may carry only
+  // serialBytes and revokeDate
   virtual std::vector<CertificateModelPtr>
-  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial) = 0;
-  virtual CertificateModelPtr GetLastRevoked(const std::string &caSerial) = 0;
+  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                      std::int32_t partition,
+                                      const DateTime &validAt) = 0;
+  virtual CertificateModelPtr GetLastRevoked(const std::string &caSerial,
+                                             std::int32_t partition) = 0;
+
+  // runs generate holding CRL generation lock of the CA partition shared by
+  // all server instances, waits up to wait for it; false, generate not run,
+  // when it is still held elsewhere
+  virtual bool TryWithCrlLock(const std::string &caSerial,
+                              std::int32_t partition,
+                              std::chrono::milliseconds wait,
+                              const std::function<void()> &generate) = 0;
+
+  // idempotency keys of issuance, see service/idempotency.h
+  // stores pending key, false when the key has a row that is not expired
+  virtual bool ClaimIdempotencyKey(const IdempotencyModel &model) = 0;
+  // null when there is no row or it is expired
+  virtual IdempotencyModelPtr GetIdempotencyKey(const std::string &key) = 0;
+  // stores result and new expire date of claimed key
+  virtual void CompleteIdempotencyKey(const IdempotencyModel &model) = 0;
+  virtual void DeleteIdempotencyKey(const std::string &key) = 0;
+  virtual void DeleteExpiredIdempotencyKeys(const DateTime &now) = 0;
 };
 
 using IDataBasePtr = std::shared_ptr<IDataBase>;
@@ -0,0 +1,79 @@
+#ifndef _CASERV_DB_INVALIDATION_H_
+#define _CASERV_DB_INVALIDATION_H_
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace db {
+
+/*
+    Change of shared data published by a database write, used to drop
+    cached copies in other server instances. Payload is
+    "ca:{serial}", "crl:{caSerial}:{partition}" or
+    "revoked:{serial}:{caSerial}:{partition}" with upper case serials
+    (PostgreSQL queries build it, see postgre/queries.h). Partition is
+    optional, payloads of older instances have none.
+*/
+enum class InvalidationType { Ca, Crl, Revoked };
+
+struct Invalidation {
+  InvalidationType type;
+  std::string serial;
+  // set for Revoked
+  std::string caSerial;
+  // CRL partition of Crl and Revoked
+  std::int32_t partition{0};
+};
+
+// splits optional ":{partition}" suffix off value
+inline bool parse_partition(std::string_view &value, std::int32_t &partition) {
+  auto separator = value.find(':');
+  if (separator == std::string_view::npos)
+    return true;
+  auto text = value.substr(separator + 1);
+  auto [end, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), partition);
+  if (ec != std::errc() || end != text.data() + text.size() || partition < 0)
+    return false;
+  value = value.substr(0, separator);
+  return true;
+}
+
+inline std::optional<Invalidation> parse_invalidation(std::string_view payload) {
+  auto separator = payload.find(':');
+  if (separator == std::string_view::npos)
+    return std::nullopt;
+  auto kind = payload.substr(0, separator);
+  auto value = payload.substr(separator + 1);
+  if (value.empty())
+    return std::nullopt;
+  if (kind == "ca")
+    return Invalidation{InvalidationType::Ca, std::string(value), {}};
+  if (kind == "crl") {
+    std::int32_t partition = 0;
+    if (!parse_partition(value, partition))
+      return std::nullopt;
+    return Invalidation{InvalidationType::Crl, std::string(value), {},
+                        partition};
+  }
+  if (kind == "revoked") {
+    auto caSeparator = value.find(':');
+    if (caSeparator == std::string_view::npos)
+      return std::nullopt;
+    auto caSerial = value.substr(caSeparator + 1);
+    std::int32_t partition = 0;
+    if (!parse_partition(caSerial, partition))
+      return std::nullopt;
+    return Invalidation{InvalidationType::Revoked,
+                        std::string(value.substr(0, caSeparator)),
+                        std::string(caSerial), partition};
+  }
+  return std::nullopt;
+}
+
+} // namespace db
+
+#endif //_CASERV_DB_INVALIDATION_H_
@@ -1,49 +1,120 @@
 #ifndef _CASERV_DB_MODELS_H_
 #define _CASERV_DB_MODELS_H_
 
+#include "./../../common/arena.h"
 #include "./../../common/datetime.h"
 #include "./../../common/paged_response.h"
 #include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace db {
 namespace models {
 using namespace datetime;
 
+/*
+    Read models below keep strings as views. Rows returned by IDataBase are
+    owned by a RowSet and its arena, on write paths views point to caller data.
+*/
 struct CertificateModel {
-  std::string serial;
-  std::string thumbprint;
-  std::string caSerial;
-  std::string commonName;
-  DateTimePtr issueDate;
-  DateTimePtr revokeDate;
+  std::string_view serial;
+  std::string_view thumbprint;
+  std::string_view caSerial;
+  std::string_view commonName;
+  DateTime issueDate;
+  // notAfter of the certificate, not set for rows stored before it was kept
+  DateTimeOpt expireDate;
+  DateTimeOpt revokeDate;
+  // CRL partition named in CDP, 0 - full CRL only
+  std::int32_t crlPartition{0};
+  // stored serial bytes, set on rows of the revoked list read for CRLs
+  std::span<const std::byte> serialBytes;
 };
 
 struct CertificateAuthorityModel {
   std::string serial;
   std::string thumbprint;
   std::string commonName;
-  DateTimePtr issueDate;
+  DateTime issueDate;
   std::vector<std::byte> certificate;
   std::vector<std::byte> privateKey;
   std::string publicUrl;
 };
 
+// CA row without key material, for listing and lookup endpoints
+struct CertificateAuthorityMetadataModel {
+  std::string_view serial;
+  std::string_view thumbprint;
+  std::string_view commonName;
+  DateTime issueDate;
+  std::string_view publicUrl;
+};
+
+/*
+    Rows of one query result with their strings stored in a single arena.
+    Row pointers handed out share ownership of the whole set, so reading N
+    rows costs a constant number of allocations.
+*/
+template <typename TRow> struct RowSet {
+  RowSet(std::size_t rowCount, std::size_t stringBytes) : arena(stringBytes) {
+    rows.reserve(rowCount);
+  }
+
+  common::Arena arena;
+  std::vector<TRow> rows;
+};
+
+template <typename TRow>
+std::shared_ptr<TRow> share_row(const std::shared_ptr<RowSet<TRow>> &set,
+                                std::size_t index) {
+  return std::shared_ptr<TRow>(set, &set->rows[index]);
+}
+
+template <typename TRow>
+std::vector<std::shared_ptr<TRow>>
+share_rows(const std::shared_ptr<RowSet<TRow>> &set) {
+  std::vector<std::shared_ptr<TRow>> result;
+  result.reserve(set->rows.size());
+  for (auto &row : set->rows)
+    result.emplace_back(set, &row);
+  return result;
+}
+
 struct CrlModel {
   std::string caSerial;
+  // 0 - full CRL of CA
+  std::int32_t partition{0};
   long number;
-  DateTimePtr issueDate;
-  DateTimePtr expireDate;
+  DateTime issueDate;
+  DateTime expireDate;
   std::string lastSerial;
   std::vector<std::byte> content;
 };
 
+/*
+    Idempotency key of a request. Pending, without serial, while the
+    request that claimed the key runs. The issued container holds the
+    client private key and is never stored, only its certificate serial.
+*/
+struct IdempotencyModel {
+  std::string key;
+  // hex SHA-256 of the request, same key with another request is rejected
+  std::string fingerprint;
+  DateTime expireDate;
+  std::string serial;
+};
+
 using CertificateModelPtr = std::shared_ptr<CertificateModel>;
 using CertificateAuthorityModelPtr = std::shared_ptr<CertificateAuthorityModel>;
+using CertificateAuthorityMetadataModelPtr =
+    std::shared_ptr<CertificateAuthorityMetadataModel>;
 using CrlModelPtr = std::shared_ptr<CrlModel>;
+using IdempotencyModelPtr = std::shared_ptr<IdempotencyModel>;
 
 using CertificateModels = PagedResponse<CertificateModelPtr>;
 using CertificateAuthorityModels = PagedResponse<CertificateAuthorityModelPtr>;
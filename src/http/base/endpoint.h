@@ -4,6 +4,8 @@
 #include <httpserver.hpp>
 #include <memory>
 
+#include "./../../common/metrics.h"
+
 using HttpResponsePtr = std::shared_ptr<httpserver::http_response>;
 
 namespace http {
@@ -15,12 +17,18 @@ public:
 
   void Register(httpserver::webserver &ws) {
     LOG_INFO("Endpoint {} added.", Route());
+    _requestTime = &metrics::histogram("caserv_http_request_seconds",
+                                       "HTTP request handling duration.",
+                                       {{"route", Route()}});
     ws.register_resource(Route(), this);
   }
 
 protected:
   virtual TRequest BuildRequestModel(const httpserver::http_request &req) = 0;
   virtual HttpResponsePtr Handle(const TRequest &model) = 0;
+
+  // set on Register, endpoints are registered before server starts
+  metrics::Histogram *_requestTime{nullptr};
 };
 } // namespace http
 
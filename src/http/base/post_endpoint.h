@@ -6,6 +6,7 @@
 #include <httpserver.hpp>
 
 #include "./../../common/logger.h"
+#include "./../../common/tracing.h"
 #include "validation_error.h"
 
 namespace http {
@@ -14,16 +15,21 @@ template <typename TRequest>
 class ApiPostEndpoint : public ApiEndpoint<TRequest> {
 public:
   HttpResponsePtr render_POST(const httpserver::http_request &req) {
+    metrics::ScopedTimer timer(*this->_requestTime);
+    tracing::RequestTrace trace(this->Route());
     try {
       auto model = this->BuildRequestModel(req);
       return this->Handle(model);
     } catch (const ValidationError &ex) {
+      trace.Fail();
       LOG_ERROR("Validation error: {}", ex.what());
       return HttpResponsePtr(new httpserver::string_response(ex.what(), 500));
     } catch (const std::exception &ex) {
+      trace.Fail();
       LOG_ERROR("{}", ex.what());
       return HttpResponsePtr(new httpserver::string_response("", 500));
     } catch (...) {
+      trace.Fail();
       LOG_ERROR("Unhandled exception");
       return HttpResponsePtr(new httpserver::string_response("", 500));
     }
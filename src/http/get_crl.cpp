@@ -1,10 +1,13 @@
 #include "get_crl.h"
 #include "base/file_response.h"
 
+#include <charconv>
+#include <cstdint>
 #include <filesystem>
 #include <httpserver.hpp>
 #include <microhttpd.h>
 #include <stdexcept>
+#include <string>
 #include <string_view>
 
 
@@ -22,8 +25,18 @@ std::string_view GetCrlEndpoint::BuildRequestModel(const httpserver::http_reques
 }
 
 HttpResponsePtr GetCrlEndpoint::Handle(const std::string_view &crlFileName) {
-    auto caSerial = std::filesystem::path(crlFileName).stem();
-    auto crl = _caService->GetCrl(caSerial);
-    if(crl.empty()) return HttpResponsePtr(new httpserver::string_response("", 404));
+    auto notFound = [] { return HttpResponsePtr(new httpserver::string_response("", 404)); };
+    // {caSerial}.crl - full CRL, {caSerial}-{partition}.crl - partition CRL
+    std::string caSerial = std::filesystem::path(crlFileName).stem();
+    std::int32_t partition = 0;
+    auto separator = caSerial.rfind('-');
+    if(separator != std::string::npos) {
+        auto text = std::string_view(caSerial).substr(separator + 1);
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), partition);
+        if(ec != std::errc() || end != text.data() + text.size() || partition <= 0) return notFound();
+        caSerial.resize(separator);
+    }
+    auto crl = _caService->GetCrl(caSerial, partition);
+    if(crl.empty()) return notFound();
     return HttpResponsePtr(new FileResponse(crl, 200));
 }
@@ -0,0 +1,34 @@
+#ifndef _CASERV_HTTP_GET_METRICS_H_
+#define _CASERV_HTTP_GET_METRICS_H_
+
+#include "./../common/metrics.h"
+#include "base/get_endpoint.h"
+
+#include <httpserver.hpp>
+#include <variant>
+
+namespace http {
+
+// Prometheus scrape endpoint
+class GetMetricsEndpoint : public ApiGetEndpoint<std::monostate> {
+public:
+  GetMetricsEndpoint() = default;
+  virtual ~GetMetricsEndpoint() = default;
+  const char *Route() const override { return "metrics"; }
+
+protected:
+  std::monostate
+  BuildRequestModel(const httpserver::http_request &) override {
+    return {};
+  }
+
+  HttpResponsePtr Handle(const std::monostate &) override {
+    return HttpResponsePtr(new httpserver::string_response(
+        metrics::Registry::Instance().Serialize(), 200,
+        "text/plain; version=0.0.4"));
+  }
+};
+
+} // namespace http
+
+#endif //_CASERV_HTTP_GET_METRICS_H_
@@ -2,53 +2,122 @@
 #define _CASERV_HTTP_ISSUE_CERTIFICATE_H_
 
 #include "./../service/caservice.h"
+#include "./../service/idempotency.h"
 #include "base/post_endpoint.h"
 
 #include <httpserver.hpp>
+#include <memory>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <microhttpd.h>
 #include "base/file_response.h"
+#include "base/validation_error.h"
 
 namespace http {
 
 using namespace nlohmann;
 using namespace nlohmann::literals;
 
+struct IssueCertificateRequest {
+  std::string caSerial;
+  service::models::IssueCertificateModel model;
+  // empty when Idempotency-Key header is not set
+  std::string idempotencyKey;
+  std::string fingerprint;
+};
+
+/*
+    Requests with Idempotency-Key header are run once per key (see
+    serivce::IdempotencyStore), retries to the same instance get the same
+    PKCS12 container, others 409.
+*/
 class IssueCertificateEndpoint
-    : public ApiPostEndpoint<std::pair<std::string_view, service::models::IssueCertificateModel>> {
+    : public ApiPostEndpoint<IssueCertificateRequest> {
 public:
-  IssueCertificateEndpoint(serivce::CaServicePtr caService)
-      : _caService(caService) {}
+  // null idempotency - Idempotency-Key header is ignored
+  IssueCertificateEndpoint(serivce::CaServicePtr caService,
+                           serivce::IdempotencyStorePtr idempotency = nullptr)
+      : _caService(caService), _idempotency(idempotency) {}
   virtual ~IssueCertificateEndpoint() = default;
   const char *Route() const override { return "ca/{caSerial}/issue/"; }
 
 protected:
-  std::pair<std::string_view, service::models::IssueCertificateModel>
+  IssueCertificateRequest
   BuildRequestModel(const httpserver::http_request &req) override {
     auto pathPieces = req.get_path_pieces();
     auto args = req.get_arg("caSerial").get_all_values();
     if (args.empty())
       throw std::runtime_error("Invalid request");
-    json jObj = json::parse(req.get_content());
-    auto issueReq = jObj.template get<service::models::IssueCertificateModel>();
-    return std::make_pair(args[0], issueReq);
+    auto content = req.get_content();
+    json jObj = json::parse(content);
+    IssueCertificateRequest result{
+        std::string(args[0]),
+        jObj.template get<service::models::IssueCertificateModel>(), {}, {}};
+    if (_idempotency == nullptr)
+      return result;
+    result.idempotencyKey = std::string(req.get_header(IDEMPOTENCY_KEY));
+    if (result.idempotencyKey.empty())
+      return result;
+    if (result.idempotencyKey.size() > MAX_KEY_SIZE)
+      throw ValidationError("Idempotency key is too long.");
+    result.fingerprint = serivce::IdempotencyStore::Fingerprint(
+        result.caSerial + "\n" + std::string(content));
+    return result;
   }
 
-  HttpResponsePtr Handle(
-      const std::pair<std::string_view, service::models::IssueCertificateModel>
-          &args) override {
-    auto result = _caService->CreateClientCertificate(args.first, args.second);
+  HttpResponsePtr Handle(const IssueCertificateRequest &args) override {
+    if (args.idempotencyKey.empty()) {
+      auto result =
+          _caService->CreateClientCertificate(args.caSerial, args.model);
+      if (result == nullptr)
+        return HttpResponsePtr(new httpserver::string_response("", 404));
+      return HttpResponsePtr(new FileResponse(
+          std::format("{}.{}", result->serialNumber, result->fileExtension),
+          result->container, 200));
+    }
 
+    // duplicates block in Execute until the first request completes
+    serivce::IdempotentResultPtr result;
+    try {
+      result = _idempotency->Execute(
+          args.idempotencyKey, args.fingerprint,
+          [this, &args]() -> serivce::IdempotentResultPtr {
+            auto container =
+                _caService->CreateClientCertificate(args.caSerial, args.model);
+            if (container == nullptr)
+              return nullptr;
+            return std::make_shared<const serivce::IdempotentResult>(
+                serivce::IdempotentResult{
+                    std::format("{}.{}", container->serialNumber,
+                                container->fileExtension),
+                    std::move(container->container),
+                    container->serialNumber});
+          });
+    } catch (const serivce::IdempotencyError &ex) {
+      LOG_WARNING("{}: {}", args.idempotencyKey, ex.what());
+      auto status =
+          ex.GetReason() == serivce::IdempotencyError::Reason::Mismatch
+              ? 422
+              : 409;
+      return HttpResponsePtr(
+          new httpserver::string_response(ex.what(), status));
+    }
     if (result == nullptr)
       return HttpResponsePtr(new httpserver::string_response("", 404));
-    return HttpResponsePtr(new FileResponse(std::format("{}.pfx", result->serialNumber), result->container, 200));
+    return HttpResponsePtr(
+        new FileResponse(result->fileName, result->content, 200));
   }
 
 private:
+  static constexpr const char *IDEMPOTENCY_KEY = "Idempotency-Key";
+  // idempotency."key" column size
+  static constexpr std::size_t MAX_KEY_SIZE = 250;
+
   serivce::CaServicePtr _caService;
+  serivce::IdempotencyStorePtr _idempotency;
 };
 
 } // namespace http
 
-#endif //_CASERV_HTTP_ISSUE_CERTIFICATE_H_
\ No newline at end of file
+#endif //_CASERV_HTTP_ISSUE_CERTIFICATE_H_
@@ -0,0 +1,59 @@
+#ifndef _CASERV_HTTP_SIGN_CERTIFICATE_H_
+#define _CASERV_HTTP_SIGN_CERTIFICATE_H_
+
+#include "./../service/caservice.h"
+#include "base/post_endpoint.h"
+
+#include <httpserver.hpp>
+#include <string_view>
+#include <utility>
+#include <microhttpd.h>
+#include "base/file_response.h"
+
+namespace http {
+
+using namespace nlohmann;
+using namespace nlohmann::literals;
+
+/*
+    Issue certificate for PKCS#10 request, key pair is generated by client.
+    Returns PEM certificate, no private key and no PKCS12 container.
+*/
+class SignCertificateEndpoint
+    : public ApiPostEndpoint<std::pair<std::string_view, service::models::SignCertificateModel>> {
+public:
+  SignCertificateEndpoint(serivce::CaServicePtr caService)
+      : _caService(caService) {}
+  virtual ~SignCertificateEndpoint() = default;
+  const char *Route() const override { return "ca/{caSerial}/sign/"; }
+
+protected:
+  std::pair<std::string_view, service::models::SignCertificateModel>
+  BuildRequestModel(const httpserver::http_request &req) override {
+    auto args = req.get_arg("caSerial").get_all_values();
+    if (args.empty())
+      throw std::runtime_error("Invalid request");
+    json jObj = json::parse(req.get_content());
+    auto signReq = jObj.template get<service::models::SignCertificateModel>();
+    if (signReq.csr.empty())
+      throw ValidationError("csr is required.");
+    return std::make_pair(args[0], signReq);
+  }
+
+  HttpResponsePtr Handle(
+      const std::pair<std::string_view, service::models::SignCertificateModel>
+          &args) override {
+    auto result = _caService->SignClientCertificate(args.first, args.second);
+
+    if (result == nullptr)
+      return HttpResponsePtr(new httpserver::string_response("", 404));
+    return HttpResponsePtr(new FileResponse(std::format("{}.crt", result->serialNumber), result->certificate, 200));
+  }
+
+private:
+  serivce::CaServicePtr _caService;
+};
+
+} // namespace http
+
+#endif //_CASERV_HTTP_SIGN_CERTIFICATE_H_
@@ -0,0 +1,431 @@
+#include "memory_database.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./../common/hex.h"
+#include "./../common/logger.h"
+
+using namespace inmemory;
+
+static std::string Key(const std::string_view &serial) {
+  std::string key(serial);
+  std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+  return key;
+}
+
+static std::shared_ptr<RowSet<CertificateModel>>
+CopyCertificate(const CertificateModel &cert, const DateTimeOpt &revokeDate) {
+  // decoded serial is kept for CRL entries
+  auto set = std::make_shared<RowSet<CertificateModel>>(
+      1, cert.serial.size() + cert.thumbprint.size() + cert.caSerial.size() +
+             cert.commonName.size() + cert.serial.size() / 2);
+  auto &arena = set->arena;
+  auto serialBytes = hex::decode(cert.serial);
+  set->rows.push_back(CertificateModel{.serial = arena.Store(cert.serial),
+                                       .thumbprint = arena.Store(cert.thumbprint),
+                                       .caSerial = arena.Store(cert.caSerial),
+                                       .commonName = arena.Store(cert.commonName),
+                                       .issueDate = cert.issueDate,
+                                       .expireDate = cert.expireDate,
+                                       .revokeDate = revokeDate,
+                                       .crlPartition = cert.crlPartition,
+                                       .serialBytes = arena.Store(serialBytes)});
+  return set;
+}
+
+MemoryDatabase::MemoryDatabase(IDataBasePtr backend) : _backend(backend) {
+  if (_backend != nullptr)
+    Refresh();
+}
+
+MemoryDatabase::~MemoryDatabase() {}
+
+void MemoryDatabase::Refresh() {
+  if (_backend == nullptr)
+    return;
+  auto start = std::chrono::steady_clock::now();
+  std::size_t certificates = 0;
+  for (const auto &metadata : _backend->GetAllCa()) {
+    auto ca = _backend->GetCa(std::string(metadata->serial));
+    if (ca == nullptr)
+      continue;
+    ApplyCa(*ca);
+    // older CRL versions are not needed to serve requests, partition CRLs
+    // are read on first request
+    RefreshCrl(ca->serial, 0);
+  }
+  std::vector<std::pair<std::string, std::int32_t>> partitions;
+  {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    for (const auto &[serial, entry] : _ca)
+      for (const auto &[partition, history] : entry.crl)
+        if (partition != 0)
+          partitions.emplace_back(serial, partition);
+  }
+  for (const auto &[serial, partition] : partitions)
+    RefreshCrl(serial, partition);
+  for (const auto &cert : _backend->GetAllCertificates()) {
+    ApplyCertificate(*cert);
+    ++certificates;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  LOG_INFO("In-memory database loaded {} CA, {} certificates in {} ms.",
+           GetAllCa().size(), certificates, elapsed.count());
+}
+
+void MemoryDatabase::Invalidate(const Invalidation &invalidation) {
+  if (_backend == nullptr)
+    return;
+  switch (invalidation.type) {
+  case InvalidationType::Ca:
+    if (auto ca = _backend->GetCa(invalidation.serial))
+      ApplyCa(*ca);
+    break;
+  case InvalidationType::Crl:
+    RefreshCrl(invalidation.serial, invalidation.partition);
+    break;
+  case InvalidationType::Revoked:
+    // certificates issued by other instances are not announced, the row is
+    // added here when missing
+    if (auto cert = _backend->GetCertificate(invalidation.serial))
+      ApplyCertificate(*cert);
+    break;
+  }
+}
+
+void MemoryDatabase::ApplyCa(const CertificateAuthorityModel &ca) {
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  auto entry = FindCa(ca.serial);
+  if (entry == nullptr || entry->ca == nullptr)
+    StoreCa(ca);
+}
+
+void MemoryDatabase::ApplyCertificate(const CertificateModel &cert) {
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  auto it = _certificates.find(Key(cert.serial));
+  if (it != _certificates.end() &&
+      it->second->rows[0].revokeDate == cert.revokeDate)
+    return;
+  if (it == _certificates.end())
+    StoreCertificate(cert);
+  if (cert.revokeDate.has_value())
+    StoreRevoked(std::string(cert.serial), *cert.revokeDate);
+}
+
+CrlModelPtr MemoryDatabase::ApplyCrl(const CrlModel &crl) {
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  auto &history = _ca[Key(crl.caSerial)].crl[crl.partition];
+  if (history.empty() || history.back()->number < crl.number)
+    StoreCrl(crl);
+  return history.back();
+}
+
+CrlModelPtr MemoryDatabase::RefreshCrl(const std::string &caSerial,
+                                       std::int32_t partition) {
+  auto crl = _backend->GetActualCrl(caSerial, partition);
+  if (crl == nullptr)
+    return nullptr;
+  return ApplyCrl(*crl);
+}
+
+const MemoryDatabase::CaEntry *
+MemoryDatabase::FindCa(const std::string_view &serial) const {
+  auto it = _ca.find(Key(serial));
+  return it == _ca.end() ? nullptr : &it->second;
+}
+
+void MemoryDatabase::StoreCertificate(const CertificateModel &cert) {
+  auto key = Key(cert.serial);
+  if (_certificates.contains(key))
+    throw std::runtime_error("Certificate already exists.");
+  _certificates.emplace(key, CopyCertificate(cert, std::nullopt));
+  _ca[Key(cert.caSerial)].certificates.push_back(std::move(key));
+}
+
+void MemoryDatabase::StoreCa(const CertificateAuthorityModel &ca) {
+  auto &entry = _ca[Key(ca.serial)];
+  if (entry.ca != nullptr)
+    throw std::runtime_error("CA already exists.");
+  entry.ca = std::make_shared<CertificateAuthorityModel>(ca);
+  auto set = std::make_shared<RowSet<CertificateAuthorityMetadataModel>>(1, 0);
+  // views into the immutable full row, it lives as long as the entry
+  set->rows.push_back(CertificateAuthorityMetadataModel{
+      .serial = entry.ca->serial,
+      .thumbprint = entry.ca->thumbprint,
+      .commonName = entry.ca->commonName,
+      .issueDate = entry.ca->issueDate,
+      .publicUrl = entry.ca->publicUrl});
+  entry.metadata = set;
+}
+
+void MemoryDatabase::StoreRevoked(const std::string &serial,
+                                  const DateTime &revokeDate) {
+  auto it = _certificates.find(Key(serial));
+  if (it == _certificates.end())
+    return;
+  const auto &current = it->second->rows[0];
+  auto &revoked = _ca[Key(current.caSerial)].revoked;
+  if (current.revokeDate.has_value())
+    revoked.erase(RevokedKey{*current.revokeDate, it->first});
+  // readers may still hold the previous row, replace instead of update
+  auto row = CopyCertificate(current, revokeDate);
+  revoked.emplace(RevokedKey{revokeDate, it->first}, row);
+  it->second = row;
+}
+
+void MemoryDatabase::StoreCrl(const CrlModel &crl) {
+  auto &history = _ca[Key(crl.caSerial)].crl[crl.partition];
+  auto model = std::make_shared<CrlModel>(crl);
+  auto pos = std::upper_bound(
+      history.begin(), history.end(), model->number,
+      [](long number, const CrlModelPtr &it) { return number < it->number; });
+  history.insert(pos, model);
+}
+
+CertificateModelPtr MemoryDatabase::GetCertificate(const std::string &serial) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  auto it = _certificates.find(Key(serial));
+  if (it == _certificates.end())
+    return nullptr;
+  return share_row(it->second, 0);
+}
+
+std::vector<CertificateModelPtr>
+MemoryDatabase::GetCertificates(const std::string &caSerial) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  std::vector<CertificateModelPtr> result;
+  auto entry = FindCa(caSerial);
+  if (entry == nullptr)
+    return result;
+  result.reserve(entry->certificates.size());
+  for (const auto &key : entry->certificates)
+    result.push_back(share_row(_certificates.at(key), 0));
+  return result;
+}
+
+std::vector<CertificateModelPtr> MemoryDatabase::GetAllCertificates() {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  std::vector<CertificateModelPtr> result;
+  result.reserve(_certificates.size());
+  for (const auto &it : _certificates)
+    result.push_back(share_row(it.second, 0));
+  return result;
+}
+
+CertificateAuthorityModelPtr MemoryDatabase::GetCa(const std::string &serial) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  auto entry = FindCa(serial);
+  if (entry == nullptr || entry->ca == nullptr)
+    return nullptr;
+  // callers take ownership of key material, hand out a copy
+  return std::make_shared<CertificateAuthorityModel>(*entry->ca);
+}
+
+CertificateAuthorityMetadataModelPtr
+MemoryDatabase::GetCaMetadata(const std::string &serial) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  auto entry = FindCa(serial);
+  if (entry == nullptr || entry->ca == nullptr)
+    return nullptr;
+  return share_row(entry->metadata, 0);
+}
+
+std::vector<CertificateAuthorityMetadataModelPtr> MemoryDatabase::GetAllCa() {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  std::vector<CertificateAuthorityMetadataModelPtr> result;
+  for (const auto &it : _ca) {
+    if (it.second.ca != nullptr)
+      result.push_back(share_row(it.second.metadata, 0));
+  }
+  return result;
+}
+
+std::vector<std::byte>
+MemoryDatabase::GetCaCertificateData(const std::string &serial) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  auto entry = FindCa(serial);
+  if (entry == nullptr || entry->ca == nullptr)
+    return std::vector<std::byte>();
+  return entry->ca->certificate;
+}
+
+void MemoryDatabase::AddCertificate(const CertificateModel &cert) {
+  if (_backend != nullptr)
+    _backend->AddCertificate(cert);
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  StoreCertificate(cert);
+}
+
+void MemoryDatabase::AddCA(const CertificateAuthorityModel &ca) {
+  if (_backend != nullptr)
+    _backend->AddCA(ca);
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  StoreCa(ca);
+}
+
+void MemoryDatabase::MakeCertificateRevoked(const std::string &serial,
+                                            const DateTime revokeDate) {
+  if (_backend != nullptr)
+    _backend->MakeCertificateRevoked(serial, revokeDate);
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  StoreRevoked(serial, revokeDate);
+}
+
+std::vector<CertificateModelPtr>
+MemoryDatabase::GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                                    std::int32_t partition,
+                                                    const DateTime &validAt) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  std::vector<CertificateModelPtr> result;
+  auto entry = FindCa(caSerial);
+  if (entry == nullptr)
+    return result;
+  result.reserve(entry->revoked.size());
+  for (auto it = entry->revoked.rbegin(); it != entry->revoked.rend(); ++it) {
+    const auto &cert = it->second->rows[0];
+    if (partition != 0 && cert.crlPartition != partition)
+      continue;
+    if (cert.expireDate.has_value() && *cert.expireDate < validAt)
+      continue;
+    result.push_back(share_row(it->second, 0));
+  }
+  return result;
+}
+
+CertificateModelPtr MemoryDatabase::GetLastRevoked(const std::string &caSerial,
+                                                   std::int32_t partition) {
+  std::shared_lock<std::shared_mutex> lock(_mutex);
+  auto entry = FindCa(caSerial);
+  if (entry == nullptr)
+    return nullptr;
+  for (auto it = entry->revoked.rbegin(); it != entry->revoked.rend(); ++it) {
+    if (partition == 0 || it->second->rows[0].crlPartition == partition)
+      return share_row(it->second, 0);
+  }
+  return nullptr;
+}
+
+void MemoryDatabase::AddCrl(const CrlModel &crl) {
+  if (_backend != nullptr)
+    _backend->AddCrl(crl);
+  std::unique_lock<std::shared_mutex> lock(_mutex);
+  StoreCrl(crl);
+}
+
+CrlModelPtr MemoryDatabase::GetActualCrl(const std::string &caSerial,
+                                         std::int32_t partition) {
+  {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    auto entry = FindCa(caSerial);
+    if (entry != nullptr) {
+      auto it = entry->crl.find(partition);
+      if (it != entry->crl.end() && !it->second.empty())
+        return it->second.back();
+    }
+  }
+  // partition CRL is not loaded on start, next number comes from backend
+  if (_backend == nullptr || partition == 0)
+    return nullptr;
+  return RefreshCrl(caSerial, partition);
+}
+
+bool MemoryDatabase::TryWithCrlLock(const std::string &caSerial,
+                                    std::int32_t partition,
+                                    std::chrono::milliseconds wait,
+                                    const std::function<void()> &generate) {
+  if (_backend != nullptr)
+    return _backend->TryWithCrlLock(caSerial, partition, wait, [&] {
+      // CRL of another instance may not be delivered yet, its number must
+      // not be reused
+      RefreshCrl(caSerial, partition);
+      generate();
+    });
+  auto key = Key(caSerial) + ":" + std::to_string(partition);
+  {
+    std::unique_lock<std::mutex> lock(_crlLocksMutex);
+    if (!_crlLockReleased.wait_for(lock, wait, [&] {
+          return !_crlLocks.contains(key);
+        }))
+      return false;
+    _crlLocks.insert(key);
+  }
+  auto unlock = [&] {
+    {
+      std::lock_guard<std::mutex> lock(_crlLocksMutex);
+      _crlLocks.erase(key);
+    }
+    _crlLockReleased.notify_all();
+  };
+  try {
+    generate();
+  } catch (...) {
+    unlock();
+    throw;
+  }
+  unlock();
+  return true;
+}
+
+bool MemoryDatabase::ClaimIdempotencyKey(const IdempotencyModel &model) {
+  if (_backend != nullptr)
+    return _backend->ClaimIdempotencyKey(model);
+  std::lock_guard<std::mutex> lock(_idempotencyMutex);
+  auto it = _idempotency.find(model.key);
+  if (it != _idempotency.end() && it->second.expireDate >= utc_now())
+    return false;
+  IdempotencyModel pending{model.key, model.fingerprint, model.expireDate, {}};
+  _idempotency.insert_or_assign(model.key, std::move(pending));
+  return true;
+}
+
+IdempotencyModelPtr MemoryDatabase::GetIdempotencyKey(const std::string &key) {
+  if (_backend != nullptr)
+    return _backend->GetIdempotencyKey(key);
+  std::lock_guard<std::mutex> lock(_idempotencyMutex);
+  auto it = _idempotency.find(key);
+  if (it == _idempotency.end() || it->second.expireDate < utc_now())
+    return nullptr;
+  return std::make_shared<IdempotencyModel>(it->second);
+}
+
+void MemoryDatabase::CompleteIdempotencyKey(const IdempotencyModel &model) {
+  if (_backend != nullptr) {
+    _backend->CompleteIdempotencyKey(model);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_idempotencyMutex);
+  auto it = _idempotency.find(model.key);
+  if (it == _idempotency.end())
+    return;
+  it->second.expireDate = model.expireDate;
+  it->second.serial = model.serial;
+}
+
+void MemoryDatabase::DeleteIdempotencyKey(const std::string &key) {
+  if (_backend != nullptr) {
+    _backend->DeleteIdempotencyKey(key);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_idempotencyMutex);
+  _idempotency.erase(key);
+}
+
+void MemoryDatabase::DeleteExpiredIdempotencyKeys(const DateTime &now) {
+  if (_backend != nullptr) {
+    _backend->DeleteExpiredIdempotencyKeys(now);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(_idempotencyMutex);
+  std::erase_if(_idempotency,
+                [&now](const auto &item) { return item.second.expireDate < now; });
+}
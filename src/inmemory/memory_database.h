@@ -0,0 +1,127 @@
+#ifndef _CASERV_INMEMORY_MEMORY_DATABASE_H_
+#define _CASERV_INMEMORY_MEMORY_DATABASE_H_
+
+#include "./../db/idatabase.h"
+#include "./../db/invalidation.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace inmemory {
+
+using namespace db;
+using namespace db::models;
+
+/*
+    IDataBase kept in process memory. Serials are matched case insensitive,
+    same as PgDatabase queries.
+
+    Without backend it is a standalone database (benchmarks, tests). With
+    backend it is a write-through cache: all data is loaded at construction,
+    writes go to backend first and are applied locally only when backend
+    accepted them, reads never leave the process. Writes of other instances
+    are read from backend by Invalidate when they are delivered
+    (PqListener); CRL generation always continues from the backend's
+    actual CRL.
+*/
+class MemoryDatabase : public IDataBase {
+public:
+  explicit MemoryDatabase(IDataBasePtr backend = nullptr);
+  ~MemoryDatabase();
+
+  CertificateModelPtr GetCertificate(const std::string &serial) override;
+  std::vector<CertificateModelPtr>
+  GetCertificates(const std::string &caSerial) override;
+  std::vector<CertificateModelPtr> GetAllCertificates() override;
+  CertificateAuthorityModelPtr GetCa(const std::string &serial) override;
+  CertificateAuthorityMetadataModelPtr
+  GetCaMetadata(const std::string &serial) override;
+  std::vector<CertificateAuthorityMetadataModelPtr> GetAllCa() override;
+  std::vector<std::byte> GetCaCertificateData(const std::string &serial) override;
+  void AddCertificate(const CertificateModel &cert) override;
+  void AddCA(const CertificateAuthorityModel &ca) override;
+
+  void MakeCertificateRevoked(const std::string &serial,
+                              const DateTime revokeDate) override;
+  std::vector<CertificateModelPtr>
+  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                      std::int32_t partition,
+                                      const DateTime &validAt) override;
+  CertificateModelPtr GetLastRevoked(const std::string &caSerial,
+                                     std::int32_t partition) override;
+
+  void AddCrl(const CrlModel &crl) override;
+  CrlModelPtr GetActualCrl(const std::string &caSerial,
+                           std::int32_t partition) override;
+  bool TryWithCrlLock(const std::string &caSerial, std::int32_t partition,
+                      std::chrono::milliseconds wait,
+                      const std::function<void()> &generate) override;
+  bool ClaimIdempotencyKey(const IdempotencyModel &model) override;
+  IdempotencyModelPtr GetIdempotencyKey(const std::string &key) override;
+  void CompleteIdempotencyKey(const IdempotencyModel &model) override;
+  void DeleteIdempotencyKey(const std::string &key) override;
+  void DeleteExpiredIdempotencyKeys(const DateTime &now) override;
+
+  // reads the changed rows from backend
+  void Invalidate(const Invalidation &invalidation);
+  // notifications may have been missed, merges all data of backend
+  void Refresh();
+
+private:
+  // rows are immutable once stored, updates replace the whole row
+  using CertificateRow = std::shared_ptr<RowSet<CertificateModel>>;
+  using CaMetadataRow = std::shared_ptr<RowSet<CertificateAuthorityMetadataModel>>;
+  using RevokedKey = std::pair<DateTime, std::string>;
+
+  struct CaEntry {
+    // null when certificates or CRL arrived before the CA row
+    CertificateAuthorityModelPtr ca;
+    CaMetadataRow metadata;
+    // certificate serial keys in insertion order
+    std::vector<std::string> certificates;
+    // ordered by revoke date, then serial
+    std::map<RevokedKey, CertificateRow> revoked;
+    // by partition, append-only, ordered by number
+    std::map<std::int32_t, std::vector<CrlModelPtr>> crl;
+  };
+
+  // merge rows read from backend, newer data of this instance is kept
+  void ApplyCa(const CertificateAuthorityModel &ca);
+  void ApplyCertificate(const CertificateModel &cert);
+  CrlModelPtr ApplyCrl(const CrlModel &crl);
+  CrlModelPtr RefreshCrl(const std::string &caSerial, std::int32_t partition);
+  void StoreCertificate(const CertificateModel &cert);
+  void StoreCa(const CertificateAuthorityModel &ca);
+  void StoreRevoked(const std::string &serial, const DateTime &revokeDate);
+  void StoreCrl(const CrlModel &crl);
+  const CaEntry *FindCa(const std::string_view &serial) const;
+
+private:
+  IDataBasePtr _backend;
+  std::unordered_map<std::string, CertificateRow> _certificates;
+  std::unordered_map<std::string, CaEntry> _ca;
+  mutable std::shared_mutex _mutex;
+  // CA partition keys with CRL generation in progress, without backend
+  std::unordered_set<std::string> _crlLocks;
+  std::mutex _crlLocksMutex;
+  std::condition_variable _crlLockReleased;
+  // idempotency keys, without backend
+  std::unordered_map<std::string, IdempotencyModel> _idempotency;
+  std::mutex _idempotencyMutex;
+};
+
+using MemoryDatabasePtr = std::shared_ptr<MemoryDatabase>;
+
+} // namespace inmemory
+
+#endif //_CASERV_INMEMORY_MEMORY_DATABASE_H_
@@ -3,7 +3,10 @@
 #include "defines.h"
 #include "subject_builder.h"
 #include "utils.h"
+#include <algorithm>
+#include <cstddef>
 #include <ctime>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <openssl/asn1.h>
@@ -11,14 +14,24 @@
 #include <openssl/crypto.h>
 #include <openssl/evp.h>
 #include <openssl/x509.h>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
 #include "./../common/datetime.h"
+#include "./../common/metrics.h"
+#include "./../common/tracing.h"
 
 using namespace openssl;
 
+#define CRYPTO_TIMER(stage)                                                    \
+  static auto &cryptoTime = metrics::histogram(                                \
+      "caserv_crypto_seconds", "Crypto operation duration by stage.",         \
+      {{"stage", stage}});                                                     \
+  metrics::ScopedTimer cryptoTimer(cryptoTime);                               \
+  tracing::ScopedSpan cryptoSpan("crypto." stage)
+
 static _::PhysicalPersonCertificateSubjectBuilder PhysicalPersonSubjectBuilder;
 static _::IndividualEntrepreneurCertificateSubjectBuilder
     IndividualEntrepreneurSubjectBuilder;
@@ -35,98 +48,178 @@ static std::unordered_map<contracts::AlgorithmEnum, PkeyParams> PkeyOptions{
       .p1 = NID_id_tc26_gost_3410_2012_512_paramSetA,
       .digest = NID_id_GostR3411_2012_512}}};
 
-// use basic params for CA root cert
-static std::map<int, std::string> CaExtensions{
-    {NID_subject_key_identifier, "hash"},
-    {NID_basic_constraints, "CA:TRUE,pathlen:0"},
-    {NID_key_usage, "critical,cRLSign,digitalSignature,keyCertSign"},
-    {NID_certificate_policies,
-     "1.2.643.100.113.1,1.2.643.100.113.2,anyPolicy"}};
-
-static std::map<int, std::string> ClientExtensions{
-    {NID_subject_key_identifier, "hash"},
-    {NID_authority_key_identifier, "keyid,issuer"},
-    {NID_key_usage, "critical, digitalSignature"},
-    {NID_ext_key_usage, "clientAuth,"
-                        "emailProtection,"
-                        "1.2.643.2.2.34.6,"
-                        "1.2.643.3.88.3.6,"
-                        "1.2.643.3.88.1.1.1.7,"
-                        "1.2.643.3.88.1.1.1.9,"
-                        "1.2.643.3.88.1.1.1.10,"
-                        "1.2.643.3.88.1.1.1.11"}};
+// constant extensions come from the profile, these depend on the issuer
+static const std::map<int, std::string> IssuerExtensions{
+    {NID_authority_key_identifier, "keyid,issuer"}};
 
 static std::map<int, std::string> CrlExtensions{
     {NID_authority_key_identifier, "keyid,issuer"},
     /*{NID_crl_number, "1"}*/};
 
-OpensslCryptoProvider::OpensslCryptoProvider() {}
+OpensslCryptoProvider::OpensslCryptoProvider()
+    : OpensslCryptoProvider(CertificateProfiles::Load("")) {}
+
+OpensslCryptoProvider::OpensslCryptoProvider(CertificateProfilesPtr profiles)
+    : _profiles(std::move(profiles)) {
+  // register custom OIDs and resolve subject objects once
+  subject_objects();
+}
 
 OpensslCryptoProvider::~OpensslCryptoProvider() {}
 
 PKCS12ContainerUPtr OpensslCryptoProvider::GenerateClientCertitificate(
-    const PhysicalPersonCertificateRequest &req, const CaInfo &caInfo) {
-  auto subject = PhysicalPersonSubjectBuilder.SubjectName(req);
-  auto cert =
-      GenerateX509Certitificate(req.algorithm, subject, req.ttlInDays, &caInfo);
-  auto result = new PKCS12Container{
-      .container = openssl::create_pfx(
-          openssl::get_private_key(cert->privateKey),
-          openssl::get_certificate(cert->certificate),
-          openssl::get_certificate(caInfo.certificate), nullptr, req.pin.data()),
-      .serialNumber = cert->serialNumber,
-      .thumbprint = cert->thumbprint};
-  return std::move(PKCS12ContainerUPtr(result));
+    const PhysicalPersonCertificateRequest &req, const CaInfo &caInfo,
+    common::Arena &arena) {
+  auto subject = PhysicalPersonSubjectBuilder.SubjectName(req, arena.Resource());
+  return GenerateClientContainer(req, subject, caInfo);
 }
 
 PKCS12ContainerUPtr OpensslCryptoProvider::GenerateClientCertitificate(
-    const IndividualEntrepreneurCertificateRequest &req, const CaInfo &caInfo) {
-  auto subject = IndividualEntrepreneurSubjectBuilder.SubjectName(req);
-  auto cert =
-      GenerateX509Certitificate(req.algorithm, subject, req.ttlInDays, &caInfo);
-  auto result = new PKCS12Container{
-      .container = openssl::create_pfx(
-          openssl::get_private_key(cert->privateKey),
-          openssl::get_certificate(cert->certificate),
-          openssl::get_certificate(caInfo.certificate), nullptr, req.pin.data()),
-      .serialNumber = cert->serialNumber,
-      .thumbprint = cert->thumbprint};
-  return std::move(PKCS12ContainerUPtr(result));
+    const IndividualEntrepreneurCertificateRequest &req, const CaInfo &caInfo,
+    common::Arena &arena) {
+  auto subject =
+      IndividualEntrepreneurSubjectBuilder.SubjectName(req, arena.Resource());
+  return GenerateClientContainer(req, subject, caInfo);
 }
 
 PKCS12ContainerUPtr OpensslCryptoProvider::GenerateClientCertitificate(
-    const JuridicalPersonCertificateRequest &req, const CaInfo &caInfo) {
-  auto subject = JuridicalPersonSubjectBuilder.SubjectName(req);
-  auto cert =
-      GenerateX509Certitificate(req.algorithm, subject, req.ttlInDays, &caInfo);
-  auto result = new PKCS12Container{
-      .container = openssl::create_pfx(
-          openssl::get_private_key(cert->privateKey),
-          openssl::get_certificate(cert->certificate),
-          openssl::get_certificate(caInfo.certificate), nullptr, req.pin.data()),
-      .serialNumber = cert->serialNumber,
-      .thumbprint = cert->thumbprint};
-  return std::move(PKCS12ContainerUPtr(result));
+    const JuridicalPersonCertificateRequest &req, const CaInfo &caInfo,
+    common::Arena &arena) {
+  auto subject =
+      JuridicalPersonSubjectBuilder.SubjectName(req, arena.Resource());
+  return GenerateClientContainer(req, subject, caInfo);
+}
+
+PKCS12ContainerUPtr OpensslCryptoProvider::GenerateClientContainer(
+    const CertificateRequestBase &req, const SubjectEntries &subject,
+    const CaInfo &caInfo) {
+  auto profile =
+      GetProfile(req.profile, CertificateProfiles::DEFAULT_CLIENT_PROFILE);
+  auto issuer = GetIssuer(caInfo);
+  // container is built from the generated objects directly, no PEM round trip
+  auto [cert, key] =
+      GenerateX509Certitificate(req.algorithm, subject, req.ttlInDays, *profile,
+                                issuer.get(), req.crlPartition);
+  auto result = std::make_unique<PKCS12Container>();
+  if (profile->container == ContainerFormat::Pem) {
+    CRYPTO_TIMER("pem");
+    result->container =
+        openssl::create_pem_bundle(key.get(), cert.get(), issuer->cert.get(),
+                                   req.pin.data(), profile->pkcs12);
+    result->fileExtension = "pem";
+  } else {
+    CRYPTO_TIMER("pkcs12");
+    result->container =
+        openssl::create_pfx(key.get(), cert.get(), issuer->cert.get(), nullptr,
+                            req.pin.data(), profile->pkcs12);
+  }
+  result->serialNumber = openssl::get_serial_hex(cert.get());
+  result->thumbprint = openssl::get_thumbprint_SHA1(cert.get());
+  result->notAfter = openssl::get_not_after(cert.get());
+  return result;
+}
+
+CertificateUPtr OpensslCryptoProvider::SignCertificateRequest(
+    const PhysicalPersonCertificateRequest &req, const std::string_view &csr,
+    const CaInfo &caInfo, common::Arena &arena) {
+  auto subject = PhysicalPersonSubjectBuilder.SubjectName(req, arena.Resource());
+  return SignClientRequest(req, subject, csr, caInfo);
+}
+
+CertificateUPtr OpensslCryptoProvider::SignCertificateRequest(
+    const IndividualEntrepreneurCertificateRequest &req,
+    const std::string_view &csr, const CaInfo &caInfo, common::Arena &arena) {
+  auto subject =
+      IndividualEntrepreneurSubjectBuilder.SubjectName(req, arena.Resource());
+  return SignClientRequest(req, subject, csr, caInfo);
+}
+
+CertificateUPtr OpensslCryptoProvider::SignCertificateRequest(
+    const JuridicalPersonCertificateRequest &req, const std::string_view &csr,
+    const CaInfo &caInfo, common::Arena &arena) {
+  auto subject =
+      JuridicalPersonSubjectBuilder.SubjectName(req, arena.Resource());
+  return SignClientRequest(req, subject, csr, caInfo);
+}
+
+CertificateUPtr OpensslCryptoProvider::SignClientRequest(
+    const CertificateRequestBase &req, const SubjectEntries &subject,
+    const std::string_view &csr, const CaInfo &caInfo) {
+  auto profile =
+      GetProfile(req.profile, CertificateProfiles::DEFAULT_CLIENT_PROFILE);
+
+  auto bio = BIO_new_mem_buf(csr.data(), static_cast<int>(csr.size()));
+  X509ReqUptr x509Req(PEM_read_bio_X509_REQ(bio, nullptr, nullptr, nullptr),
+                      ::X509_REQ_free);
+  BIO_free(bio);
+  if (x509Req == nullptr)
+    throw errors::CryptoProviderError("Invalid certificate request.");
+
+  // proof of possession: request is signed by the key it carries
+  auto key = X509_REQ_get0_pubkey(x509Req.get());
+  if (key == nullptr || X509_REQ_verify(x509Req.get(), key) != 1) {
+    LOG_ERROR("CSR verification failed. {}", openssl::get_errors_string());
+    throw errors::CryptoProviderError(
+        "Certificate request signature verification failed.");
+  }
+  auto keyType = EVP_PKEY_base_id(key);
+  auto supported = std::any_of(
+      PkeyOptions.begin(), PkeyOptions.end(),
+      [keyType](const auto &it) { return it.second.keytype == keyType; });
+  if (!supported)
+    throw errors::CryptoProviderError("Unsupported certificate request key.");
+
+  // subject and extensions follow profile, csr provides the key only
+  auto issuer = GetIssuer(caInfo);
+  auto cert = BuildX509Certificate(key, subject, req.ttlInDays, *profile,
+                                   issuer.get(), req.crlPartition);
+  auto result = std::make_unique<Certificate>();
+  result->certificate = openssl::get_certificate_data(cert.get());
+  result->serialNumber = openssl::get_serial_hex(cert.get());
+  result->thumbprint = openssl::get_thumbprint_SHA1(cert.get());
+  result->notAfter = openssl::get_not_after(cert.get());
+  return result;
 }
 
 CertificateUPtr OpensslCryptoProvider::GeneratedCACertificate(
     const JuridicalPersonCertificateRequest &req) {
-  auto subject = JuridicalPersonSubjectBuilder.SubjectName(req);
-  return GenerateX509Certitificate(req.algorithm, subject, req.ttlInDays,
-                                   nullptr);
+  common::Arena arena;
+  auto subject =
+      JuridicalPersonSubjectBuilder.SubjectName(req, arena.Resource());
+  auto profile = GetProfile(req.profile, CertificateProfiles::DEFAULT_CA_PROFILE);
+  auto [cert, key] = GenerateX509Certitificate(req.algorithm, subject,
+                                               req.ttlInDays, *profile, nullptr);
+  auto result = std::make_unique<Certificate>();
+  result->certificate = openssl::get_certificate_data(cert.get());
+  result->privateKey = openssl::get_private_key_data(key.get());
+  result->serialNumber = openssl::get_serial_hex(cert.get());
+  result->thumbprint = openssl::get_thumbprint_SHA1(cert.get());
+  result->notAfter = openssl::get_not_after(cert.get());
+  return result;
 }
 
 CrlUPtr OpensslCryptoProvider::GenerateCrl(const CrlRequest &req,
                                            const CaInfo &CaInfo,
-                                           const DateTimePtr &issueDate,
-                                           const DateTimePtr &expireDate) {
-  EVP_PKEY *issuerKp = openssl::get_private_key(CaInfo.privateKey);
-  X509 *issuerCert = openssl::get_certificate(CaInfo.certificate);
+                                           const DateTime &issueDate,
+                                           const DateTime &expireDate) {
+  CRYPTO_TIMER("crl");
+  // partition CRL names the CDP of its certificates, RFC 5280 5.2.5
+  std::string idp;
+  if (req.partition != 0) {
+    const auto &points = CaInfo.crlPartitionDistributionPoints;
+    auto index = static_cast<std::size_t>(req.partition - 1);
+    if (req.partition < 0 || index >= points.size())
+      throw errors::CryptoProviderError("Unknown CRL partition.");
+    idp = fmt::format("critical,fullname:URI:{}", points[index]);
+  }
+  auto issuer = GetIssuer(CaInfo);
+  EVP_PKEY *issuerKp = issuer->key.get();
+  X509 *issuerCert = issuer->cert.get();
 
   auto lasUpdate = ASN1_UTCTIME_new();
   auto nextUpdate = ASN1_UTCTIME_new();
-  ASN1_UTCTIME_adj(lasUpdate, *issueDate, 0, 0);
-  ASN1_UTCTIME_adj(nextUpdate, *expireDate, 0, 0);
+  ASN1_UTCTIME_adj(lasUpdate, issueDate.value, 0, 0);
+  ASN1_UTCTIME_adj(nextUpdate, expireDate.value, 0, 0);
 
   auto crl = X509_CRL_new();
   OSSL_CHECK(X509_CRL_set_version(crl, X509_CRL_VERSION_2));
@@ -143,8 +236,7 @@ CrlUPtr OpensslCryptoProvider::GenerateCrl(const CrlRequest &req,
   ASN1_INTEGER_free(crlNumber);
   for (auto e : req.entries) {
     if (!e.serialNumber.empty()) {
-      auto revoked =
-          CreateRevokedEntry(e.serialNumber.data(), *e.revokationDate);
+      auto revoked = CreateRevokedEntry(e.serialNumber, e.revokationDate);
       OSSL_CHECK(X509_CRL_add0_revoked(crl, revoked));
     }
   }
@@ -171,13 +263,21 @@ CrlUPtr OpensslCryptoProvider::GenerateCrl(const CrlRequest &req,
       OSSL_CHECK(X509_CRL_add_ext(crl, ext, -1));
     }
   }
+  if (!idp.empty()) {
+    auto ext = X509V3_EXT_conf_nid(nullptr, &ctx,
+                                   NID_issuing_distribution_point, idp.c_str());
+    if (ext == nullptr) {
+      X509_CRL_free(crl);
+      throw errors::CryptoProviderError("Issuing distribution point failed.");
+    }
+    auto added = X509_CRL_add_ext(crl, ext, -1);
+    X509_EXTENSION_free(ext);
+    OSSL_CHECK(added);
+  }
 
   const EVP_MD *md = EVP_get_digestbynid(GetMDId(issuerKp));
   OSSL_CHECK(X509_CRL_sign(crl, issuerKp, md));
 
-  X509_free(issuerCert);
-  EVP_PKEY_free(issuerKp);
-
   auto result = new Crl{.content = openssl::get_crl_data(crl)};
   X509_CRL_free(crl);
   return std::move(CrlUPtr(result));
@@ -185,6 +285,7 @@ CrlUPtr OpensslCryptoProvider::GenerateCrl(const CrlRequest &req,
 
 OpensslCryptoProvider::EvpPkeyUPtr
 OpensslCryptoProvider::GenerateKeyPair(const PkeyParams &params) {
+  CRYPTO_TIMER("keygen");
   EVP_PKEY *pkey{EVP_PKEY_new()};
   EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_id(params.keytype, nullptr);
   if (ctx == nullptr) {
@@ -208,155 +309,213 @@ OpensslCryptoProvider::GenerateKeyPair(const PkeyParams &params) {
   }
 }
 
-CertificateUPtr OpensslCryptoProvider::GenerateX509Certitificate(
-    const AlgorithmEnum &algorithm,
-    const std::vector<std::pair<std::string_view, std::string_view>> &subject,
-    const long &ttlInDays, const CaInfo *caInfo) {
-
-  EVP_PKEY *issuerKp = nullptr;
-  X509 *issuerCert = nullptr;
-
-  if (caInfo != nullptr) {
-    issuerKp = openssl::get_private_key(caInfo->privateKey);
-    if (issuerKp == nullptr)
-      throw errors::CryptoProviderError("CA private key not set.");
-    issuerCert = openssl::get_certificate(caInfo->certificate);
-    if (issuerCert == nullptr)
-      throw errors::CryptoProviderError("CA certificate not set.");
+/*
+    Subject key identifier, same value as "hash" config: SHA1 of public key.
+*/
+static void AddSubjectKeyId(X509 *cert) {
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int len{0};
+  OSSL_CHECK(X509_pubkey_digest(cert, EVP_sha1(), md, &len));
+  auto keyId = ASN1_OCTET_STRING_new();
+  OSSL_CHECK(ASN1_OCTET_STRING_set(keyId, md, len));
+  auto rc = X509_add1_ext_i2d(cert, NID_subject_key_identifier, keyId, 0,
+                              X509V3_ADD_DEFAULT);
+  ASN1_OCTET_STRING_free(keyId);
+  OSSL_CHECK(rc);
+}
+
+CertificateProfilePtr
+OpensslCryptoProvider::GetProfile(const std::string_view &name,
+                                  const std::string_view &defaultName) const {
+  auto profile = _profiles->Find(name.empty() ? defaultName : name);
+  if (profile == nullptr) {
+    LOG_ERROR("Certificate profile {} not found.", name);
+    throw errors::CryptoProviderError("Certificate profile not found.");
   }
+  return profile;
+}
 
-  try {
-    auto pkeyParamsIt = PkeyOptions.find(algorithm);
-    if (pkeyParamsIt == PkeyOptions.end()) {
-      LOG_ERROR("Unsupported algorithm {}.", (int)algorithm);
-      throw errors::CryptoProviderError("Unsupported AlgorithmEnum.");
+OpensslCryptoProvider::IssuerTemplatePtr
+OpensslCryptoProvider::GetIssuer(const CaInfo &caInfo) {
+  if (caInfo.serial.empty())
+    return CreateIssuer(caInfo);
+  {
+    std::shared_lock<std::shared_mutex> lock(_issuersMutex);
+    auto it = _issuers.find(caInfo.serial);
+    if (it != _issuers.end())
+      return it->second;
+  }
+  auto issuer = CreateIssuer(caInfo);
+  std::unique_lock<std::shared_mutex> lock(_issuersMutex);
+  return _issuers.emplace(caInfo.serial, issuer).first->second;
+}
+
+OpensslCryptoProvider::IssuerTemplatePtr
+OpensslCryptoProvider::CreateIssuer(const CaInfo &caInfo) {
+  auto issuer = std::make_shared<IssuerTemplate>();
+  issuer->key.reset(openssl::get_private_key(caInfo.privateKey));
+  if (issuer->key == nullptr)
+    throw errors::CryptoProviderError("CA private key not set.");
+  issuer->cert.reset(openssl::get_certificate(caInfo.certificate));
+  if (issuer->cert == nullptr)
+    throw errors::CryptoProviderError("CA certificate not set.");
+
+  X509V3_CTX ctx;
+  X509V3_CONF_METHOD conf;
+  ConfigDatabase db;
+  init_extension_context(ctx, conf, db, issuer->cert.get());
+
+  auto &extensions = issuer->extensions;
+  for (const auto &extIt : IssuerExtensions) {
+    encode_extension(extensions, &ctx, extIt.first, extIt.second.c_str());
+  }
+
+  if (!caInfo.crlDistributionPoints.empty()) {
+    auto &points = issuer->distributionPoints;
+    auto cdp = fmt::format("URI:{}", fmt::join(caInfo.crlDistributionPoints, ","));
+    encode_extension(points, &ctx, NID_crl_distribution_points, cdp.c_str());
+    // certificate of a partition names only the partition CRL
+    for (const auto &url : caInfo.crlPartitionDistributionPoints) {
+      auto partitionCdp = fmt::format("URI:{}", url);
+      encode_extension(points, &ctx, NID_crl_distribution_points,
+                       partitionCdp.c_str());
     }
+    if (points.size() != caInfo.crlPartitionDistributionPoints.size() + 1)
+      throw errors::CryptoProviderError("CRL distribution point encoding failed.");
+  }
 
-    auto params = pkeyParamsIt->second;
-    auto key = GenerateKeyPair(params);
+  // fill info access
+  std::string aia;
+  if (!caInfo.caEndPoints.empty()) {
+    fmt::format_to(std::back_inserter(aia), "caIssuers;URI:{}",
+                   fmt::join(caInfo.caEndPoints, ","));
+  }
+  if (!caInfo.ocspEndPoints.empty()) {
+    fmt::format_to(std::back_inserter(aia), "{}OCSP;URI:{}",
+                   aia.empty() ? "" : ",",
+                   fmt::join(caInfo.ocspEndPoints, ","));
+  }
+  if (!aia.empty()) {
+    encode_extension(extensions, &ctx, NID_info_access, aia.c_str());
+  }
+  return issuer;
+}
 
-    if (caInfo == nullptr)
-      issuerKp = key.get();
+std::pair<OpensslCryptoProvider::X509Uptr, OpensslCryptoProvider::EvpPkeyUPtr>
+OpensslCryptoProvider::GenerateX509Certitificate(
+    const AlgorithmEnum &algorithm, const SubjectEntries &subject,
+    const long &ttlInDays, const CertificateProfile &profile,
+    const IssuerTemplate *issuer, std::int32_t crlPartition) {
+  auto pkeyParamsIt = PkeyOptions.find(algorithm);
+  if (pkeyParamsIt == PkeyOptions.end()) {
+    LOG_ERROR("Unsupported algorithm {}.", (int)algorithm);
+    throw errors::CryptoProviderError("Unsupported AlgorithmEnum.");
+  }
 
-    auto cert = X509_new();
+  auto params = pkeyParamsIt->second;
+  auto key = GenerateKeyPair(params);
+  auto cert = BuildX509Certificate(key.get(), subject, ttlInDays, profile,
+                                   issuer, crlPartition);
+  return std::make_pair(std::move(cert), std::move(key));
+}
+
+OpensslCryptoProvider::X509Uptr OpensslCryptoProvider::BuildX509Certificate(
+    EVP_PKEY *key, const SubjectEntries &subject, const long &ttlInDays,
+    const CertificateProfile &profile, const IssuerTemplate *issuer,
+    std::int32_t crlPartition) {
+  try {
+    X509Uptr cert(X509_new(), ::X509_free);
 
     // set serial number
-    ASN1_STRING *serialNumber = X509_get_serialNumber(cert);
-    std::vector<uint8_t> serial(SERIAL_LEN);
-    OSSL_CHECK(RAND_bytes(serial.data(), SERIAL_LEN));
-    OSSL_CHECK(ASN1_STRING_set(serialNumber, serial.data(), SERIAL_LEN));
+    ASN1_STRING *serialNumber = X509_get_serialNumber(cert.get());
+    uint8_t serial[SERIAL_LEN];
+    OSSL_CHECK(RAND_bytes(serial, SERIAL_LEN));
+    OSSL_CHECK(ASN1_STRING_set(serialNumber, serial, SERIAL_LEN));
 
     // 0x00 - v1, 0x01 - v2, 0x02 - v3
-    OSSL_CHECK(X509_set_version(cert, 0x02));
+    OSSL_CHECK(X509_set_version(cert.get(), 0x02));
     // set dates
-    X509_gmtime_adj(X509_get_notBefore(cert), 0);
+    X509_gmtime_adj(X509_get_notBefore(cert.get()), 0);
     auto ttlSeconds = 86400L * ttlInDays;
-    X509_gmtime_adj(X509_get_notAfter(cert), ttlSeconds);
+    X509_gmtime_adj(X509_get_notAfter(cert.get()), ttlSeconds);
 
     // Set certificate subject data
-    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME *name = X509_get_subject_name(cert.get());
 
-    for (auto subjPair : subject) {
-      NameAddEntry(name, subjPair.first, subjPair.second);
+    if (profile.subject.empty()) {
+      for (const auto &[attribute, value] : subject) {
+        NameAddEntry(name, subject_object(attribute), value);
+      }
+    } else {
+      // profile defines attribute set and order
+      for (auto attribute : profile.subject) {
+        auto it = std::find_if(subject.begin(), subject.end(),
+                               [&](const auto &e) { return e.first == attribute; });
+        if (it != subject.end())
+          NameAddEntry(name, subject_object(attribute), it->second);
+      }
     }
 
     // set public key
-    OSSL_CHECK(X509_set_pubkey(cert, key.get()));
+    OSSL_CHECK(X509_set_pubkey(cert.get(), key));
 
     // set issuer
     // if issuer is null, create self signed cert
-    if (issuerCert == nullptr)
-      issuerCert = cert;
+    X509 *issuerCert = issuer == nullptr ? cert.get() : issuer->cert.get();
+    EVP_PKEY *issuerKp = issuer == nullptr ? key : issuer->key.get();
     auto issuerName = X509_get_subject_name(issuerCert);
-    OSSL_CHECK(X509_set_issuer_name(cert, issuerName));
-
-    // Init context
-    X509V3_CTX ctx;
-    // setup context
-    X509V3_set_ctx(&ctx, issuerCert, cert, nullptr, nullptr, 0);
-
-    // setup db and db_meth, we need it for certificate policies
-    X509V3_CONF_METHOD conf;
-    conf.get_string = openssl::db_get_string;
-    conf.get_section = openssl::db_get_section;
-    conf.free_string = openssl::db_free_string;
-    conf.free_section = openssl::db_free_section;
-    ConfigDatabase db;
-    ctx.db = &db;
-    ctx.db_meth = &conf;
-
-    // setup extensions
-    auto extensions = caInfo == nullptr
-                          ? std::map<int, std::string>(CaExtensions)
-                          : std::map<int, std::string>(ClientExtensions);
-    if (caInfo != nullptr) {
-      if (!caInfo->crlDistributionPoints.empty()) {
-        extensions.insert(
-            {NID_crl_distribution_points,
-             fmt::format("URI:{}",
-                         fmt::join(caInfo->crlDistributionPoints, ","))});
-      }
+    OSSL_CHECK(X509_set_issuer_name(cert.get(), issuerName));
 
-      // fill info access
-      std::vector<std::string> info;
-      if (!caInfo->caEndPoints.empty()) {
-        info.push_back(fmt::format("caIssuers;URI:{}",
-                                   fmt::join(caInfo->caEndPoints, ",")));
-      }
-      if (!caInfo->ocspEndPoints.empty()) {
-        info.push_back(
-            fmt::format("OCSP;URI:{}", fmt::join(caInfo->ocspEndPoints, ",")));
-      }
-      if (!info.empty()) {
-        extensions.insert(
-            {NID_info_access, fmt::format("{}", fmt::join(info, ","))});
-      }
-    }
+    AddSubjectKeyId(cert.get());
 
-    for (auto extIt : extensions) {
-      auto ext =
-          X509V3_EXT_conf_nid(nullptr, &ctx, extIt.first, extIt.second.c_str());
-      if (ext != nullptr) {
-        OSSL_CHECK(X509_add_ext(cert, ext, -1));
-        X509_EXTENSION_free(ext);
-      } else {
-        LOG_WARNING("Failed to add cerificate extensions. NID: {}, "
-                    "extensions: {}. Error: {}.",
-                    extIt.first, extIt.second, openssl::get_errors_string());
+    // X509_add_ext copies the prebuilt extensions
+    for (const auto &ext : profile.extensions) {
+      OSSL_CHECK(X509_add_ext(cert.get(), ext.get(), -1));
+    }
+    if (issuer != nullptr) {
+      for (const auto &ext : issuer->extensions) {
+        OSSL_CHECK(X509_add_ext(cert.get(), ext.get(), -1));
+      }
+      const auto &points = issuer->distributionPoints;
+      if (!points.empty()) {
+        auto index = static_cast<std::size_t>(crlPartition);
+        if (crlPartition < 0 || index >= points.size())
+          throw errors::CryptoProviderError("Unknown CRL partition.");
+        OSSL_CHECK(X509_add_ext(cert.get(), points[index].get(), -1));
       }
     }
 
     // sign cert
-    const EVP_MD *md = EVP_get_digestbynid(openssl::GetMDId(issuerKp));
-    OSSL_CHECK(X509_sign(cert, issuerKp, md));
-    auto thumbprint = openssl::get_thumbprint_SHA1(cert);
-    auto serialHex = openssl::get_serial_hex(cert);
-
-    auto result = new Certificate();
-    result->certificate = openssl::get_certificate_data(cert);
-    result->privateKey = openssl::get_private_key_data(key.get());
-    result->serialNumber = serialHex;
-    result->thumbprint = thumbprint;
-    return std::move(CertificateUPtr(result));
+    auto mdNid =
+        profile.digest != NID_undef ? profile.digest : openssl::GetMDId(issuerKp);
+    const EVP_MD *md = EVP_get_digestbynid(mdNid);
+    {
+      CRYPTO_TIMER("sign");
+      OSSL_CHECK(X509_sign(cert.get(), issuerKp, md));
+    }
+    return cert;
 
   } catch (...) {
-    throw std::runtime_error("GenerateX509Certitificate error.");
+    throw std::runtime_error("BuildX509Certificate error.");
   }
 }
 
 X509_REVOKED *
-OpensslCryptoProvider::CreateRevokedEntry(const std::string_view serial,
+OpensslCryptoProvider::CreateRevokedEntry(std::span<const std::byte> serial,
                                           const DateTime &revokeDate) {
+  // stored serials are positive and at most 20 bytes (RFC 5280 4.1.2.2),
+  // copied straight into the integer content
+  if (serial.empty() || serial.size() > MAX_SERIAL_LEN)
+    throw errors::CryptoProviderError("Invalid revoked certificate serial.");
   auto revoked = X509_REVOKED_new();
-
-  BIGNUM *bn{nullptr};
-  BN_hex2bn(&bn, serial.data());
-  auto asn1Serial = BN_to_ASN1_INTEGER(bn, nullptr);
+  auto asn1Serial = ASN1_INTEGER_new();
+  OSSL_CHECK(ASN1_STRING_set(asn1Serial, serial.data(),
+                             static_cast<int>(serial.size())));
   OSSL_CHECK(X509_REVOKED_set_serialNumber(revoked, asn1Serial));
   ASN1_INTEGER_free(asn1Serial);
 
   auto asn1RevokeDate = ASN1_UTCTIME_new();
-  ASN1_UTCTIME_adj(asn1RevokeDate, revokeDate, 0, 0);
+  ASN1_UTCTIME_adj(asn1RevokeDate, revokeDate.value, 0, 0);
   OSSL_CHECK(X509_REVOKED_set_revocationDate(revoked, asn1RevokeDate));
   ASN1_UTCTIME_free(asn1RevokeDate);
 
@@ -2,7 +2,10 @@
 #define _CASERV_OPENSSL_CRYPTO_PROVIDER_H_
 
 #include "./../base/icrypto_provider.h"
+#include "profile.h"
+#include "subject_builder.h"
 
+#include <cstdint>
 #include <ctime>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
@@ -19,7 +22,11 @@
 #include <openssl/txt_db.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
+#include <shared_mutex>
+#include <span>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -29,6 +36,7 @@ using namespace base;
 using namespace contracts;
 
 #define SERIAL_LEN 16 // 128 bit
+#define MAX_SERIAL_LEN 20 // RFC 5280
 
 struct PkeyParams {
   int keytype;
@@ -40,32 +48,79 @@ struct PkeyParams {
 class OpensslCryptoProvider : public ICryptoProvider {
 public:
   OpensslCryptoProvider();
+  explicit OpensslCryptoProvider(CertificateProfilesPtr profiles);
   virtual ~OpensslCryptoProvider();
 
   PKCS12ContainerUPtr
   GenerateClientCertitificate(const PhysicalPersonCertificateRequest &req,
-                              const CaInfo &caInfo) override;
+                              const CaInfo &caInfo,
+                              common::Arena &arena) override;
 
   PKCS12ContainerUPtr GenerateClientCertitificate(
       const IndividualEntrepreneurCertificateRequest &req,
-      const CaInfo &caInfo) override;
+      const CaInfo &caInfo, common::Arena &arena) override;
 
   PKCS12ContainerUPtr
   GenerateClientCertitificate(const JuridicalPersonCertificateRequest &req,
-                              const CaInfo &caInfo) override;
+                              const CaInfo &caInfo,
+                              common::Arena &arena) override;
+
+  CertificateUPtr
+  SignCertificateRequest(const PhysicalPersonCertificateRequest &req,
+                         const std::string_view &csr, const CaInfo &caInfo,
+                         common::Arena &arena) override;
+
+  CertificateUPtr
+  SignCertificateRequest(const IndividualEntrepreneurCertificateRequest &req,
+                         const std::string_view &csr, const CaInfo &caInfo,
+                         common::Arena &arena) override;
+
+  CertificateUPtr
+  SignCertificateRequest(const JuridicalPersonCertificateRequest &req,
+                         const std::string_view &csr, const CaInfo &caInfo,
+                         common::Arena &arena) override;
 
   CertificateUPtr
   GeneratedCACertificate(const JuridicalPersonCertificateRequest &req) override;
-  CrlUPtr GenerateCrl(const CrlRequest& req, const CaInfo& CaInfo, const DateTimePtr &issueDate, const DateTimePtr &expireDate) override;
+  CrlUPtr GenerateCrl(const CrlRequest& req, const CaInfo& CaInfo, const DateTime &issueDate, const DateTime &expireDate) override;
 
 private:
   using EvpPkeyUPtr = std::unique_ptr<EVP_PKEY, decltype(&::EVP_PKEY_free)>;
   using X509Uptr = std::unique_ptr<X509, decltype(&::X509_free)>;
   using X509CrlUptr = std::unique_ptr<X509_CRL, decltype(&::X509_CRL_free)>;
+  using X509ReqUptr = std::unique_ptr<X509_REQ, decltype(&::X509_REQ_free)>;
+
+  /*
+      Parsed CA certificate and key with issuer dependent extensions (AKI,
+      CDP, AIA) encoded once. Extensions are copied into every issued
+      certificate as is.
+  */
+  struct IssuerTemplate {
+    X509Uptr cert{nullptr, ::X509_free};
+    EvpPkeyUPtr key{nullptr, ::EVP_PKEY_free};
+    X509Extensions extensions;
+    // CDP by CRL partition, [0] - full CRL, empty when CA has no CDP
+    X509Extensions distributionPoints;
+  };
+  using IssuerTemplatePtr = std::shared_ptr<const IssuerTemplate>;
 
   EvpPkeyUPtr GenerateKeyPair(const PkeyParams &params);
-  CertificateUPtr GenerateX509Certitificate(const AlgorithmEnum &algorithm,const std::vector<std::pair<std::string_view, std::string_view>> &subject, const long &ttlInDays, const CaInfo* caInfo);
-  X509_REVOKED* CreateRevokedEntry(const std::string_view serial, const DateTime &revokeDate);
+  IssuerTemplatePtr GetIssuer(const CaInfo &caInfo);
+  IssuerTemplatePtr CreateIssuer(const CaInfo &caInfo);
+  CertificateProfilePtr GetProfile(const std::string_view &name, const std::string_view &defaultName) const;
+  PKCS12ContainerUPtr GenerateClientContainer(const CertificateRequestBase &req, const SubjectEntries &subject, const CaInfo &caInfo);
+  CertificateUPtr SignClientRequest(const CertificateRequestBase &req, const SubjectEntries &subject, const std::string_view &csr, const CaInfo &caInfo);
+  // issuer == nullptr creates self signed CA certificate
+  std::pair<X509Uptr, EvpPkeyUPtr> GenerateX509Certitificate(const AlgorithmEnum &algorithm, const SubjectEntries &subject, const long &ttlInDays, const CertificateProfile &profile, const IssuerTemplate *issuer, std::int32_t crlPartition = 0);
+  // key is the subject public key, also the signing key for self signed certificate
+  X509Uptr BuildX509Certificate(EVP_PKEY *key, const SubjectEntries &subject, const long &ttlInDays, const CertificateProfile &profile, const IssuerTemplate *issuer, std::int32_t crlPartition = 0);
+  X509_REVOKED* CreateRevokedEntry(std::span<const std::byte> serial, const DateTime &revokeDate);
+
+private:
+  CertificateProfilesPtr _profiles;
+  // keyed by CA serial
+  std::unordered_map<std::string, IssuerTemplatePtr> _issuers;
+  std::shared_mutex _issuersMutex;
 };
 } // namespace openssl
 
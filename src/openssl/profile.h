@@ -0,0 +1,219 @@
+#ifndef _CASERV_OPENSSL_PROFILE_H_
+#define _CASERV_OPENSSL_PROFILE_H_
+
+#include <fstream>
+#include <memory>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/objects.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "./../libs/json.hpp"
+#include "config_db.h"
+#include "defines.h"
+#include "subject_attributes.h"
+#include "utils.h"
+
+namespace openssl {
+
+using X509ExtensionUPtr =
+    std::unique_ptr<X509_EXTENSION, decltype(&::X509_EXTENSION_free)>;
+using X509Extensions = std::vector<X509ExtensionUPtr>;
+
+/*
+    Init extension context. Config db is needed for certificate policies.
+*/
+inline void init_extension_context(X509V3_CTX &ctx, X509V3_CONF_METHOD &conf,
+                                   ConfigDatabase &db, X509 *issuerCert) {
+  X509V3_set_ctx(&ctx, issuerCert, nullptr, nullptr, nullptr, 0);
+  conf.get_string = openssl::db_get_string;
+  conf.get_section = openssl::db_get_section;
+  conf.free_string = openssl::db_free_string;
+  conf.free_section = openssl::db_free_section;
+  ctx.db = &db;
+  ctx.db_meth = &conf;
+}
+
+/*
+    Encode extension from its config form, failures are logged and skipped.
+*/
+inline void encode_extension(X509Extensions &result, X509V3_CTX *ctx, int nid,
+                             const char *value) {
+  auto ext = X509V3_EXT_conf_nid(nullptr, ctx, nid, value);
+  if (ext == nullptr) {
+    LOG_WARNING("Failed to add cerificate extensions. NID: {}, "
+                "extensions: {}. Error: {}.",
+                nid, value, openssl::get_errors_string());
+    return;
+  }
+  result.emplace_back(ext, ::X509_EXTENSION_free);
+}
+
+enum class ContainerFormat {
+  Pkcs12,
+  // certificate and encrypted PKCS8 key, for machine clients
+  Pem
+};
+
+/*
+    Issuance profile compiled from config. Immutable after load and shared
+    by all requests.
+*/
+struct CertificateProfile {
+  std::string name;
+  // subject attributes in DN order, empty - builder order
+  std::vector<SubjectAttribute> subject;
+  // constant extensions, copied into each certificate
+  X509Extensions extensions;
+  // NID_undef - digest by issuer key
+  int digest{NID_undef};
+  ContainerFormat container{ContainerFormat::Pkcs12};
+  Pkcs12Options pkcs12;
+};
+
+using CertificateProfilePtr = std::shared_ptr<const CertificateProfile>;
+
+// used when profiles file is not set or not found
+inline constexpr const char *DEFAULT_PROFILES = R"({
+  "profiles": [
+    {
+      "name": "ca",
+      "extensions": {
+        "basicConstraints": "CA:TRUE,pathlen:0",
+        "keyUsage": "critical,cRLSign,digitalSignature,keyCertSign",
+        "certificatePolicies": "1.2.643.100.113.1,1.2.643.100.113.2,anyPolicy"
+      }
+    },
+    {
+      "name": "default",
+      "extensions": {
+        "keyUsage": "critical, digitalSignature",
+        "extendedKeyUsage": "clientAuth,emailProtection,1.2.643.2.2.34.6,1.2.643.3.88.3.6,1.2.643.3.88.1.1.1.7,1.2.643.3.88.1.1.1.9,1.2.643.3.88.1.1.1.10,1.2.643.3.88.1.1.1.11"
+      },
+      "pkcs12": {
+        "keyCipher": "gost89",
+        "certCipher": "gost89",
+        "iterations": 2048,
+        "macIterations": 2048
+      }
+    },
+    {
+      "name": "machine",
+      "container": "pem",
+      "extensions": {
+        "keyUsage": "critical, digitalSignature",
+        "extendedKeyUsage": "clientAuth"
+      },
+      "pkcs12": {
+        "keyCipher": "gost89",
+        "iterations": 2048
+      }
+    }
+  ]
+})";
+
+class CertificateProfiles {
+public:
+  static constexpr std::string_view DEFAULT_CA_PROFILE{"ca"};
+  static constexpr std::string_view DEFAULT_CLIENT_PROFILE{"default"};
+
+  explicit CertificateProfiles(const nlohmann::json &config) {
+    for (const auto &item : config.at("profiles")) {
+      auto profile = Compile(item);
+      LOG_INFO("Certificate profile {} loaded.", profile->name);
+      _profiles.emplace(profile->name, std::move(profile));
+    }
+  }
+
+  /*
+      Load profiles from json file, built in defaults if path is empty or
+      file does not exist.
+  */
+  static std::shared_ptr<CertificateProfiles> Load(const std::string &path) {
+    if (!path.empty()) {
+      std::ifstream file(path);
+      if (file.is_open())
+        return std::make_shared<CertificateProfiles>(nlohmann::json::parse(file));
+      LOG_WARNING("Profiles file {} not found, defaults are used.", path);
+    }
+    return std::make_shared<CertificateProfiles>(
+        nlohmann::json::parse(DEFAULT_PROFILES));
+  }
+
+  CertificateProfilePtr Find(std::string_view name) const {
+    auto it = _profiles.find(std::string(name));
+    if (it == _profiles.end())
+      return nullptr;
+    return it->second;
+  }
+
+private:
+  static int ResolveNid(const std::string &name) {
+    auto nid = OBJ_txt2nid(name.c_str());
+    if (nid == NID_undef)
+      throw std::runtime_error("Unknown object in profile: " + name);
+    return nid;
+  }
+
+  static CertificateProfilePtr Compile(const nlohmann::json &item) {
+    auto profile = std::make_shared<CertificateProfile>();
+    item.at("name").get_to(profile->name);
+    if (item.contains("subject")) {
+      for (const auto &attribute : item.at("subject"))
+        profile->subject.push_back(
+            subject_attribute(attribute.get<std::string>()));
+    }
+    if (item.contains("digest"))
+      profile->digest = ResolveNid(item.at("digest").get<std::string>());
+    if (item.contains("container")) {
+      auto container = item.at("container").get<std::string>();
+      if (container == "pem")
+        profile->container = ContainerFormat::Pem;
+      else if (container != "pkcs12")
+        throw std::runtime_error("Unknown container format: " + container);
+    }
+    if (item.contains("pkcs12")) {
+      const auto &pkcs12 = item.at("pkcs12");
+      auto &options = profile->pkcs12;
+      if (pkcs12.contains("keyCipher"))
+        options.keyPbe = ResolveNid(pkcs12.at("keyCipher").get<std::string>());
+      if (pkcs12.contains("certCipher"))
+        options.certPbe =
+            ResolveNid(pkcs12.at("certCipher").get<std::string>());
+      if (pkcs12.contains("iterations"))
+        pkcs12.at("iterations").get_to(options.iterations);
+      if (pkcs12.contains("macIterations"))
+        pkcs12.at("macIterations").get_to(options.macIterations);
+      if (pkcs12.contains("macDigest"))
+        options.macDigest =
+            ResolveNid(pkcs12.at("macDigest").get<std::string>());
+    }
+
+    if (item.contains("extensions")) {
+      // constant extensions do not depend on issuer or subject
+      X509V3_CTX ctx;
+      X509V3_CONF_METHOD conf;
+      ConfigDatabase db;
+      init_extension_context(ctx, conf, db, nullptr);
+      for (const auto &[name, value] : item.at("extensions").items()) {
+        encode_extension(profile->extensions, &ctx, ResolveNid(name),
+                         value.get<std::string>().c_str());
+      }
+    }
+    return profile;
+  }
+
+private:
+  std::unordered_map<std::string, CertificateProfilePtr> _profiles;
+};
+
+using CertificateProfilesPtr = std::shared_ptr<CertificateProfiles>;
+
+} // namespace openssl
+
+#endif //_CASERV_OPENSSL_PROFILE_H_
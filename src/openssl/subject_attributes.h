@@ -0,0 +1,110 @@
+#ifndef _CASERV_OPENSSL_SUBJECT_ATTRIBUTES_H_
+#define _CASERV_OPENSSL_SUBJECT_ATTRIBUTES_H_
+
+#include <array>
+#include <cstddef>
+#include <openssl/asn1.h>
+#include <openssl/obj_mac.h>
+#include <openssl/objects.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace openssl {
+
+/*
+    Subject attributes supported by the builders. Index into the attribute
+    tables below.
+*/
+enum class SubjectAttribute : std::size_t {
+  CommonName,
+  Country,
+  Locality,
+  StateOrProvince,
+  StreetAddress,
+  EmailAddress,
+  Inn,
+  Snils,
+  GivenName,
+  Surname,
+  Ogrnip,
+  InnLe,
+  Ogrn,
+  Organization,
+  OrganizationUnit,
+  Title,
+  Count
+};
+
+struct SubjectAttributeInfo {
+  std::string_view name; // name used in profiles
+  int nid;               // NID_undef - registered at startup, see oid
+  const char *oid;
+};
+
+inline constexpr std::array<SubjectAttributeInfo,
+                            static_cast<std::size_t>(SubjectAttribute::Count)>
+    SUBJECT_ATTRIBUTES{{
+        {"CN", NID_commonName, nullptr},
+        {"C", NID_countryName, nullptr},
+        {"localityName", NID_localityName, nullptr},
+        {"stateOrProvinceName", NID_stateOrProvinceName, nullptr},
+        {"streetAddress", NID_streetAddress, nullptr},
+        {"emailAddress", NID_pkcs9_emailAddress, nullptr},
+        {"INN", NID_INN, nullptr},
+        {"SNILS", NID_SNILS, nullptr},
+        {"givenName", NID_givenName, nullptr},
+        {"surname", NID_surname, nullptr},
+        {"OGRNIP", NID_OGRNIP, nullptr},
+        // INN of legal entity, not known to OpenSSL 3.0
+        {"INNLE", NID_undef, "1.2.643.100.4"},
+        {"OGRN", NID_OGRN, nullptr},
+        {"O", NID_organizationName, nullptr},
+        {"OU", NID_organizationalUnitName, nullptr},
+        {"title", NID_title, nullptr},
+    }};
+
+/*
+    Attribute objects resolved once. The first call registers missing OIDs,
+    it is made at provider construction so later calls are lookups only.
+*/
+inline const std::array<const ASN1_OBJECT *, SUBJECT_ATTRIBUTES.size()> &
+subject_objects() {
+  static const auto objects = [] {
+    std::array<const ASN1_OBJECT *, SUBJECT_ATTRIBUTES.size()> result{};
+    for (std::size_t i = 0; i < SUBJECT_ATTRIBUTES.size(); ++i) {
+      const auto &info = SUBJECT_ATTRIBUTES[i];
+      auto nid = info.nid;
+      if (nid == NID_undef) {
+        nid = OBJ_txt2nid(info.oid);
+        if (nid == NID_undef)
+          nid = OBJ_create(info.oid, std::string(info.name).c_str(), nullptr);
+      }
+      result[i] = OBJ_nid2obj(nid);
+      if (result[i] == nullptr)
+        throw std::runtime_error("Cannot resolve subject attribute " +
+                                 std::string(info.name));
+    }
+    return result;
+  }();
+  return objects;
+}
+
+inline const ASN1_OBJECT *subject_object(SubjectAttribute attribute) {
+  return subject_objects()[static_cast<std::size_t>(attribute)];
+}
+
+/*
+    Attribute by profile name, throws if unknown.
+*/
+inline SubjectAttribute subject_attribute(std::string_view name) {
+  for (std::size_t i = 0; i < SUBJECT_ATTRIBUTES.size(); ++i) {
+    if (SUBJECT_ATTRIBUTES[i].name == name)
+      return static_cast<SubjectAttribute>(i);
+  }
+  throw std::runtime_error("Unknown subject attribute: " + std::string(name));
+}
+
+} // namespace openssl
+
+#endif //_CASERV_OPENSSL_SUBJECT_ATTRIBUTES_H_
@@ -1,47 +1,61 @@
 #ifndef _CASERV_OPENSSL_SUBJECT_BUILDER_H_
 #define _CASERV_OPENSSL_SUBJECT_BUILDER_H_
 
+#include <memory_resource>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "./../contracts/certificate_request.h"
+#include "subject_attributes.h"
 
 namespace openssl {
+
+// subject entries: attribute, value
+using SubjectEntries =
+    std::pmr::vector<std::pair<SubjectAttribute, std::string_view>>;
+
 namespace _ {
 
 using namespace contracts;
 
 template <typename TReq> struct BaseCertificateSubjectBuilder {
   virtual ~BaseCertificateSubjectBuilder() = default;
-  virtual std::vector<std::pair<std::string_view, std::string_view>>
-  SubjectName(const TReq &req) = 0;
+  virtual SubjectEntries SubjectName(const TReq &req,
+                                     std::pmr::memory_resource *mr) = 0;
 };
 
 struct CertificateSubjectBuilder
     : public BaseCertificateSubjectBuilder<CertificateRequestBase> {
-  std::vector<std::pair<std::string_view, std::string_view>>
-  SubjectName(const CertificateRequestBase &req) {
-    return std::vector<std::pair<std::string_view, std::string_view>>{
-        {"CN", req.commonName},
-        {"C", req.country},
-        {"localityName", req.localityName},
-        {"stateOrProvinceName", req.stateOrProvinceName},
-        {"streetAddress", req.streetAddress},
-        {"emailAddress", req.emailAddress},
-    };
+  SubjectEntries SubjectName(const CertificateRequestBase &req,
+                             std::pmr::memory_resource *mr) {
+    SubjectEntries result(mr);
+    // juridical person subject has 15 entries
+    result.reserve(15);
+    result.insert(result.end(),
+                  {
+                      {SubjectAttribute::CommonName, req.commonName},
+                      {SubjectAttribute::Country, req.country},
+                      {SubjectAttribute::Locality, req.localityName},
+                      {SubjectAttribute::StateOrProvince,
+                       req.stateOrProvinceName},
+                      {SubjectAttribute::StreetAddress, req.streetAddress},
+                      {SubjectAttribute::EmailAddress, req.emailAddress},
+                  });
+    return result;
   }
 };
 
 struct PhysicalPersonCertificateSubjectBuilder
     : public BaseCertificateSubjectBuilder<PhysicalPersonCertificateRequest>,
       CertificateSubjectBuilder {
-  std::vector<std::pair<std::string_view, std::string_view>>
-  SubjectName(const PhysicalPersonCertificateRequest &req) {
-    auto result = CertificateSubjectBuilder::SubjectName(req);
-    result.push_back({"INN", req.inn});
-    result.push_back({"SNILS", req.snils});
-    result.push_back({"givenName", req.givenName});
-    result.push_back({"surname", req.surname});
+  SubjectEntries SubjectName(const PhysicalPersonCertificateRequest &req,
+                             std::pmr::memory_resource *mr) {
+    auto result = CertificateSubjectBuilder::SubjectName(req, mr);
+    result.push_back({SubjectAttribute::Inn, req.inn});
+    result.push_back({SubjectAttribute::Snils, req.snils});
+    result.push_back({SubjectAttribute::GivenName, req.givenName});
+    result.push_back({SubjectAttribute::Surname, req.surname});
     return result;
   }
 };
@@ -50,10 +64,10 @@ struct IndividualEntrepreneurCertificateSubjectBuilder
     : public BaseCertificateSubjectBuilder<
           IndividualEntrepreneurCertificateRequest>,
       PhysicalPersonCertificateSubjectBuilder {
-  std::vector<std::pair<std::string_view, std::string_view>>
-  SubjectName(const IndividualEntrepreneurCertificateRequest &req) {
-    auto result = PhysicalPersonCertificateSubjectBuilder::SubjectName(req);
-    result.push_back({"OGRNIP", req.ogrnip});
+  SubjectEntries SubjectName(const IndividualEntrepreneurCertificateRequest &req,
+                             std::pmr::memory_resource *mr) {
+    auto result = PhysicalPersonCertificateSubjectBuilder::SubjectName(req, mr);
+    result.push_back({SubjectAttribute::Ogrnip, req.ogrnip});
     return result;
   }
 };
@@ -61,14 +75,15 @@ struct IndividualEntrepreneurCertificateSubjectBuilder
 struct JuridicalPersonCertificateSubjectBuilder
     : public BaseCertificateSubjectBuilder<JuridicalPersonCertificateRequest>,
       PhysicalPersonCertificateSubjectBuilder {
-  std::vector<std::pair<std::string_view, std::string_view>>
-  SubjectName(const JuridicalPersonCertificateRequest &req) {
-    auto result = PhysicalPersonCertificateSubjectBuilder::SubjectName(req);
-    result.push_back({"1.2.643.100.4", req.innLe}); // INN_LE
-    result.push_back({"OGRN", req.ogrn});
-    result.push_back({"O", req.organizationName});
-    result.push_back({"OU", req.organizationUnitName});
-    result.push_back({"title", req.title});
+  SubjectEntries SubjectName(const JuridicalPersonCertificateRequest &req,
+                             std::pmr::memory_resource *mr) {
+    auto result = PhysicalPersonCertificateSubjectBuilder::SubjectName(req, mr);
+    result.push_back({SubjectAttribute::InnLe, req.innLe});
+    result.push_back({SubjectAttribute::Ogrn, req.ogrn});
+    result.push_back({SubjectAttribute::Organization, req.organizationName});
+    result.push_back({SubjectAttribute::OrganizationUnit,
+                      req.organizationUnitName});
+    result.push_back({SubjectAttribute::Title, req.title});
     return result;
   }
 };
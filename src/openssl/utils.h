@@ -2,10 +2,13 @@
 #define _CASERV_OPENSSL_UTILITY_H_
 
 #include "defines.h"
+#include "./../common/datetime.h"
+#include "./../common/hex.h"
 #include <array>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <openssl/asn1.h>
 #include <openssl/bio.h>
 #include <openssl/bn.h>
@@ -16,6 +19,8 @@
 #include <openssl/pkcs12.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -95,27 +100,60 @@ inline std::vector<std::byte> get_crl_data(X509_CRL *crl) {
   return result;
 }
 
+/*
+    PKCS12 and PKCS8 encryption settings
+*/
+struct Pkcs12Options {
+  int keyPbe{NID_id_Gost28147_89};
+  int certPbe{NID_id_Gost28147_89};
+  // KDF iterations for key and certificate encryption
+  int iterations{PKCS12_DEFAULT_ITER};
+  // -1 - no MAC
+  int macIterations{PKCS12_DEFAULT_ITER};
+  // NID_undef - library default
+  int macDigest{NID_undef};
+};
+
 /* 
     Create PKCS12 container
 */
 inline std::vector<std::byte> create_pfx(EVP_PKEY *pkey, X509 *cert, X509 *ca,
                                          const char *name,
-                                         const char *password = nullptr) {
+                                         const char *password = nullptr,
+                                         const Pkcs12Options &options = {}) {
   auto castack = sk_X509_new_null();
   if (ca != nullptr) {
     sk_X509_push(castack, ca);
   }
-  auto pkcs =
-      PKCS12_create(password, name, pkey, cert, castack, NID_id_Gost28147_89,
-                    NID_id_Gost28147_89, 0, NID_gost_mac_12, 0);
-  auto bio = BIO_new(BIO_s_mem());
-  OSSL_CHECK(i2d_PKCS12_bio(bio, pkcs));
-  std::byte *data;
-  auto len = BIO_get_mem_data(bio, &data);
-  auto result = std::vector<std::byte>(data, data + len);
-  OSSL_CHECK(BIO_free(bio));
-  PKCS12_free(pkcs);
+  // MAC is set below, PKCS12_create does not take MAC digest
+  auto pkcs = PKCS12_create(password, name, pkey, cert, castack, options.keyPbe,
+                            options.certPbe, options.iterations, -1, 0);
   sk_X509_free(castack);
+  if (pkcs == nullptr)
+    throw std::runtime_error("PKCS12_create fail.");
+  if (options.macIterations != -1) {
+    const EVP_MD *md = nullptr;
+    if (options.macDigest != NID_undef &&
+        (md = EVP_get_digestbynid(options.macDigest)) == nullptr) {
+      PKCS12_free(pkcs);
+      throw std::runtime_error("PKCS12 MAC digest not available.");
+    }
+    if (!PKCS12_set_mac(pkcs, password, -1, nullptr, 0, options.macIterations,
+                        md)) {
+      PKCS12_free(pkcs);
+      throw std::runtime_error("PKCS12_set_mac fail.");
+    }
+  }
+  // encode straight into the result buffer
+  auto len = i2d_PKCS12(pkcs, nullptr);
+  if (len <= 0) {
+    PKCS12_free(pkcs);
+    throw std::runtime_error("i2d_PKCS12 fail.");
+  }
+  auto result = std::vector<std::byte>(static_cast<std::size_t>(len));
+  auto out = reinterpret_cast<unsigned char *>(result.data());
+  i2d_PKCS12(pkcs, &out);
+  PKCS12_free(pkcs);
   return result;
 }
 
@@ -124,19 +162,56 @@ inline std::vector<std::byte> create_pfx(EVP_PKEY *pkey, X509 *cert, X509 *ca,
 */
 inline void create_pfx_file(const char *fileName, EVP_PKEY *pkey, X509 *cert,
                             X509 *ca, const char *name,
-                            const char *password = nullptr) {
-  auto castack = sk_X509_new_null();
-  if (ca != nullptr) {
-    sk_X509_push(castack, ca);
-  }
-  auto pkcs =
-      PKCS12_create(password, name, pkey, cert, castack, NID_id_Gost28147_89,
-                    NID_id_Gost28147_89, 0, NID_gost_mac_12, 0);
+                            const char *password = nullptr,
+                            const Pkcs12Options &options = {}) {
+  auto data = create_pfx(pkey, cert, ca, name, password, options);
   auto file = fopen(fileName, "wb");
-  i2d_PKCS12_fp(file, pkcs);
+  fwrite(data.data(), 1, data.size(), file);
   fclose(file);
-  PKCS12_free(pkcs);
-  sk_X509_free(castack);
+}
+
+/*
+    Create PEM bundle: certificate, CA certificate and PKCS8 private key
+    encrypted with password (unencrypted if password is empty). Lighter than
+    PKCS12: one KDF run and no MAC.
+*/
+inline std::vector<std::byte> create_pem_bundle(EVP_PKEY *pkey, X509 *cert,
+                                                X509 *ca,
+                                                const char *password = nullptr,
+                                                const Pkcs12Options &options = {}) {
+  auto bio = BIO_new(BIO_s_mem());
+  try {
+    OSSL_CHECK(PEM_write_bio_X509(bio, cert));
+    if (ca != nullptr)
+      OSSL_CHECK(PEM_write_bio_X509(bio, ca));
+    if (password == nullptr || *password == '\0') {
+      OSSL_CHECK(PEM_write_bio_PKCS8PrivateKey(bio, pkey, nullptr, nullptr, 0,
+                                               nullptr, nullptr));
+    } else {
+      auto p8inf = EVP_PKEY2PKCS8(pkey);
+      if (p8inf == nullptr)
+        throw std::runtime_error("EVP_PKEY2PKCS8 fail.");
+      // cipher nid uses PBES2, otherwise nid is a PBE algorithm
+      auto cipher = EVP_get_cipherbynid(options.keyPbe);
+      auto p8 = PKCS8_encrypt(cipher != nullptr ? -1 : options.keyPbe, cipher,
+                              password, -1, nullptr, 0, options.iterations,
+                              p8inf);
+      PKCS8_PRIV_KEY_INFO_free(p8inf);
+      if (p8 == nullptr)
+        throw std::runtime_error("PKCS8_encrypt fail.");
+      auto rc = PEM_write_bio_PKCS8(bio, p8);
+      X509_SIG_free(p8);
+      OSSL_CHECK(rc);
+    }
+  } catch (...) {
+    BIO_free(bio);
+    throw;
+  }
+  std::byte *data;
+  auto len = BIO_get_mem_data(bio, &data);
+  auto result = std::vector<std::byte>(data, data + len);
+  OSSL_CHECK(BIO_free(bio));
+  return result;
 }
 
 /* 
@@ -163,18 +238,47 @@ inline void NameAddEntry(X509_NAME *name, const std::string_view field,
                          const std::string_view val, int type = MBSTRING_UTF8) {
   if (val.empty())
     return;
-  OSSL_CHECK(X509_NAME_add_entry_by_txt(
-      name, field.data(), type, (unsigned char *)val.data(), -1, -1, 0));
+  OSSL_CHECK(X509_NAME_add_entry_by_txt(name, field.data(), type,
+                                        (unsigned char *)val.data(),
+                                        static_cast<int>(val.size()), -1, 0));
 }
 
+/*
+  Add subject entry by pre-resolved object, no name lookup
+*/
+inline void NameAddEntry(X509_NAME *name, const ASN1_OBJECT *object,
+                         const std::string_view val, int type = MBSTRING_UTF8) {
+  if (val.empty())
+    return;
+  OSSL_CHECK(X509_NAME_add_entry_by_OBJ(name, object, type,
+                                        (const unsigned char *)val.data(),
+                                        static_cast<int>(val.size()), -1, 0));
+}
+
+// same text as BN_bn2hex, without BIGNUM round trip
 inline std::string get_serial_hex(X509* cert) {
   auto serial = X509_get_serialNumber(cert);
-  auto bn = ASN1_INTEGER_to_BN(serial, nullptr);
-  std::string  result(BN_bn2hex(bn));
-  BN_free(bn);
+  auto data = ASN1_STRING_get0_data(serial);
+  auto length = static_cast<std::size_t>(ASN1_STRING_length(serial));
+  std::size_t skip = 0;
+  while (skip + 1 < length && data[skip] == 0)
+    ++skip;
+  auto result = hex::encode(std::span<const unsigned char>(data + skip, length - skip));
+  if (ASN1_STRING_type(serial) == V_ASN1_NEG_INTEGER)
+    result.insert(result.begin(), '-');
   return result;
 }
 
+inline datetime::DateTime get_not_after(X509 *cert) {
+  std::tm tm{};
+  OSSL_CHECK(ASN1_TIME_to_tm(X509_get0_notAfter(cert), &tm));
+  auto days = datetime::detail::days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1,
+                                                tm.tm_mday);
+  return datetime::DateTime{static_cast<std::time_t>(
+      days * datetime::SECONDS_PER_DAY + tm.tm_hour * 3600 + tm.tm_min * 60 +
+      tm.tm_sec)};
+}
+
 inline std::string get_serial_dec(X509* cert) {
   auto serial = X509_get_serialNumber(cert);
   auto bn = ASN1_INTEGER_to_BN(serial, nullptr);
@@ -186,33 +290,24 @@ inline std::string get_serial_dec(X509* cert) {
 inline std::string get_thumbprint_SHA1(X509* cert) {
   unsigned char buf[20];
   unsigned int len = 0;
-  size_t resultLen = 0;
-  std::string result;
-  result.reserve(40);
   const auto digest = EVP_sha1();
   OSSL_CHECK(X509_digest(cert, digest, buf, &len));
-  if (OPENSSL_buf2hexstr_ex(nullptr, 0, &resultLen, buf, 20, 0) != 0)
-  {
-      result.resize(resultLen);
-      OPENSSL_buf2hexstr_ex(&result[0], resultLen, &resultLen, buf, 20, 0);
-  }
-  return result;
+  return hex::encode(std::span<const unsigned char>(buf, len));
 }
 
 
-inline char *db_get_string(void *db, const char *section, const char *value) {
-  LOG_DEBUG("db_get_string. Params: section - {}, value - {}.", section, value);
+// called for every extension parse, keep them free of side effects
+inline char *db_get_string(void *, const char *, const char *) {
   return nullptr;
 }
 
-inline STACK_OF(CONF_VALUE) * db_get_section(void *db, const char *section) {
-  LOG_DEBUG("db_get_section. Parmas: section - {}.", section);
+inline STACK_OF(CONF_VALUE) * db_get_section(void *, const char *) {
   return nullptr;
 }
 
-inline void db_free_string(void *db, char *str) { LOG_DEBUG("db_free_string"); }
+inline void db_free_string(void *, char *) {}
 
-inline void db_free_section(void *db, STACK_OF(CONF_VALUE)* section) { LOG_DEBUG("db_free_section"); }
+inline void db_free_section(void *, STACK_OF(CONF_VALUE) *) {}
 
 
 }; // namespace openssl
@@ -0,0 +1,80 @@
+#ifndef _CASERV_POSTGRE_ADVISORY_LOCK_H_
+#define _CASERV_POSTGRE_ADVISORY_LOCK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+
+#include "./../common/logger.h"
+#include "pq_connection.h"
+#include "queries.h"
+
+namespace postgre {
+
+// connections of the CRL lock pool; generations of more CA partitions at
+// once wait for a connection, reads of generate use other pools
+inline constexpr long CRL_LOCK_CONNECTIONS = 4;
+
+// lock_not_available, lock_timeout expired
+inline constexpr const char *SQLSTATE_LOCK_NOT_AVAILABLE = "55P03";
+
+/*
+    Takes session advisory lock of CRL partition generation, waits up to
+    wait. lock_timeout is left set: conn runs CRL lock statements only and
+    each lock sets it again.
+*/
+inline bool lock_crl(PqConnection &conn, const std::string &caSerial,
+                     const std::string &partition,
+                     std::chrono::milliseconds wait) {
+  if (wait.count() <= 0)
+    return conn
+        .ExecBinary(queries::TRY_LOCK_CRL, {caSerial.c_str(), partition.c_str()})
+        .GetBool(0, 0);
+  auto timeout = std::to_string(wait.count());
+  conn.ExecBinary(queries::SET_LOCK_TIMEOUT, {timeout.c_str()});
+  try {
+    conn.ExecBinary(queries::LOCK_CRL, {caSerial.c_str(), partition.c_str()});
+  } catch (const PqError &ex) {
+    if (ex.SqlState() == SQLSTATE_LOCK_NOT_AVAILABLE)
+      return false;
+    throw;
+  }
+  return true;
+}
+
+/*
+    Runs generate holding session advisory lock of CRL partition generation on
+    conn, the connection must not be used by others until it returns. A
+    lock left by failed unlock is released when the session ends.
+*/
+inline bool with_crl_lock(PqConnection &conn, const std::string &caSerial,
+                          std::int32_t partition,
+                          std::chrono::milliseconds wait,
+                          const std::function<void()> &generate) {
+  auto partitionText = std::to_string(partition);
+  if (!lock_crl(conn, caSerial, partitionText, wait))
+    return false;
+  auto unlock = [&] {
+    try {
+      conn.ExecBinary(queries::UNLOCK_CRL,
+                      {caSerial.c_str(), partitionText.c_str()});
+    } catch (const std::exception &ex) {
+      LOG_ERROR("CRL lock release of {}-{} failed: {}", caSerial, partition,
+                ex.what());
+    }
+  };
+  try {
+    generate();
+  } catch (...) {
+    unlock();
+    throw;
+  }
+  unlock();
+  return true;
+}
+
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_ADVISORY_LOCK_H_
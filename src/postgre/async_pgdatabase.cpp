@@ -0,0 +1,357 @@
+#include "async_pgdatabase.h"
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "advisory_lock.h"
+#include "call_metrics.h"
+#include "pq_readers.h"
+#include "queries.h"
+#include "./../common/tracing.h"
+
+using namespace postgre;
+
+AsyncPgDatabase::AsyncPgDatabase(const std::string_view &connectionString,
+                                 std::size_t connections)
+    : _pipeline(std::make_shared<PqPipeline>(connectionString, connections)),
+      _lockPool(std::make_shared<PqConnectionPool>(connectionString,
+                                                   CRL_LOCK_CONNECTIONS)) {}
+
+AsyncPgDatabase::~AsyncPgDatabase() {}
+
+template <typename TResult, typename TRead>
+std::future<TResult> AsyncPgDatabase::Query(metrics::Histogram &time,
+                                            const char *sql, PqParams params,
+                                            TRead read) {
+  auto promise = std::make_shared<std::promise<TResult>>();
+  auto future = promise->get_future();
+  _pipeline->Submit(
+      sql, std::move(params),
+      [promise, read = std::move(read), &time,
+       start = std::chrono::steady_clock::now()](
+          std::unique_ptr<PqResult> rows, std::exception_ptr error) {
+        time.Record(std::chrono::steady_clock::now() - start);
+        if (error) {
+          promise->set_exception(error);
+          return;
+        }
+        try {
+          if constexpr (std::is_void_v<TResult>) {
+            read(*rows);
+            promise->set_value();
+          } else {
+            promise->set_value(read(*rows));
+          }
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      });
+  return future;
+}
+
+static void Ignore(const PqResult &) {}
+
+static std::span<const std::byte> AsBytes(const std::vector<std::byte> &data) {
+  return std::span<const std::byte>(data.data(), data.size());
+}
+
+std::future<CertificateModelPtr>
+AsyncPgDatabase::GetCertificateAsync(const std::string &serial) {
+  return Query<CertificateModelPtr>(
+      DB_CALL_TIME("GetCertificate"), queries::GET_CERTIFICATE,
+      PqParams().Hex(serial), [](const PqResult &rows) -> CertificateModelPtr {
+        if (rows.Empty())
+          return nullptr;
+        return share_row(ReadCertificates(rows), 0);
+      });
+}
+
+std::future<std::vector<CertificateModelPtr>>
+AsyncPgDatabase::GetCertificatesAsync(const std::string &caSerial) {
+  return Query<std::vector<CertificateModelPtr>>(
+      DB_CALL_TIME("GetCertificates"), queries::GET_CERTIFICATES,
+      PqParams().Hex(caSerial),
+      [](const PqResult &rows) { return share_rows(ReadCertificates(rows)); });
+}
+
+std::future<std::vector<CertificateModelPtr>>
+AsyncPgDatabase::GetAllCertificatesAsync() {
+  return Query<std::vector<CertificateModelPtr>>(
+      DB_CALL_TIME("GetAllCertificates"), queries::GET_ALL_CERTIFICATES,
+      PqParams(),
+      [](const PqResult &rows) { return share_rows(ReadCertificates(rows)); });
+}
+
+std::future<std::vector<CertificateModelPtr>>
+AsyncPgDatabase::GetRevokedListOrderByRevokeDateDescAsync(
+    const std::string &caSerial, std::int32_t partition,
+    const DateTime &validAt) {
+  return Query<std::vector<CertificateModelPtr>>(
+      DB_CALL_TIME("GetRevokedListOrderByRevokeDateDesc"), queries::GET_REVOKED,
+      PqParams().Hex(caSerial).Int32(partition).Timestamp(validAt),
+      [](const PqResult &rows) { return share_rows(ReadRevoked(rows)); });
+}
+
+std::future<CertificateModelPtr>
+AsyncPgDatabase::GetLastRevokedAsync(const std::string &caSerial,
+                                     std::int32_t partition) {
+  return Query<CertificateModelPtr>(
+      DB_CALL_TIME("GetLastRevoked"), queries::GET_LAST_REVOKED,
+      PqParams().Hex(caSerial).Int32(partition), [](const PqResult &rows) -> CertificateModelPtr {
+        if (rows.Empty())
+          return nullptr;
+        return share_row(ReadCertificates(rows), 0);
+      });
+}
+
+std::future<CertificateAuthorityModelPtr>
+AsyncPgDatabase::GetCaAsync(const std::string &serial) {
+  return Query<CertificateAuthorityModelPtr>(
+      DB_CALL_TIME("GetCa"), queries::GET_CA, PqParams().Hex(serial),
+      [](const PqResult &rows) -> CertificateAuthorityModelPtr {
+        if (rows.Empty())
+          return nullptr;
+        return ReadCa(rows, 0);
+      });
+}
+
+std::future<CertificateAuthorityMetadataModelPtr>
+AsyncPgDatabase::GetCaMetadataAsync(const std::string &serial) {
+  return Query<CertificateAuthorityMetadataModelPtr>(
+      DB_CALL_TIME("GetCaMetadata"), queries::GET_CA_METADATA,
+      PqParams().Hex(serial),
+      [](const PqResult &rows) -> CertificateAuthorityMetadataModelPtr {
+        if (rows.Empty())
+          return nullptr;
+        return share_row(ReadCaMetadata(rows), 0);
+      });
+}
+
+std::future<std::vector<CertificateAuthorityMetadataModelPtr>>
+AsyncPgDatabase::GetAllCaAsync() {
+  return Query<std::vector<CertificateAuthorityMetadataModelPtr>>(
+      DB_CALL_TIME("GetAllCa"), queries::GET_ALL_CA, PqParams(),
+      [](const PqResult &rows) { return share_rows(ReadCaMetadata(rows)); });
+}
+
+std::future<std::vector<std::byte>>
+AsyncPgDatabase::GetCaCertificateDataAsync(const std::string &serial) {
+  return Query<std::vector<std::byte>>(
+      DB_CALL_TIME("GetCaCertificateData"), queries::GET_CA_CERTIFICATE_DATA,
+      PqParams().Hex(serial), [](const PqResult &rows) {
+        if (rows.Empty())
+          return std::vector<std::byte>();
+        return ReadBytes(rows, 0, 0);
+      });
+}
+
+std::future<void>
+AsyncPgDatabase::AddCertificateAsync(const CertificateModel &cert) {
+  return Query<void>(DB_CALL_TIME("AddCertificate"), queries::ADD_CERTIFICATE,
+                     PqParams()
+                         .Hex(cert.serial)
+                         .Hex(cert.thumbprint)
+                         .Hex(cert.caSerial)
+                         .Text(cert.commonName)
+                         .Timestamp(cert.issueDate)
+                         .Null()
+                         .Timestamp(cert.expireDate)
+                         .Int32(cert.crlPartition),
+                     Ignore);
+}
+
+std::future<void>
+AsyncPgDatabase::AddCAAsync(const CertificateAuthorityModel &ca) {
+  return Query<void>(DB_CALL_TIME("AddCA"), queries::ADD_CA,
+                     PqParams()
+                         .Hex(ca.serial)
+                         .Hex(ca.thumbprint)
+                         .Text(ca.commonName)
+                         .Timestamp(ca.issueDate)
+                         .Bytes(AsBytes(ca.certificate))
+                         .Bytes(AsBytes(ca.privateKey))
+                         .Text(ca.publicUrl),
+                     Ignore);
+}
+
+std::future<void>
+AsyncPgDatabase::MakeCertificateRevokedAsync(const std::string &serial,
+                                             const DateTime revokeDate) {
+  return Query<void>(DB_CALL_TIME("MakeCertificateRevoked"),
+                     queries::MAKE_CERTIFICATE_REVOKED,
+                     PqParams().Timestamp(revokeDate).Hex(serial), Ignore);
+}
+
+std::future<void> AsyncPgDatabase::AddCrlAsync(const CrlModel &crl) {
+  return Query<void>(DB_CALL_TIME("AddCrl"), queries::ADD_CRL,
+                     PqParams()
+                         .Hex(crl.caSerial)
+                         .Int32(crl.partition)
+                         .Int32(static_cast<std::int32_t>(crl.number))
+                         .Timestamp(crl.issueDate)
+                         .Timestamp(crl.expireDate)
+                         .Hex(crl.lastSerial)
+                         .Bytes(AsBytes(crl.content)),
+                     Ignore);
+}
+
+std::future<CrlModelPtr>
+AsyncPgDatabase::GetActualCrlAsync(const std::string &caSerial,
+                                   std::int32_t partition) {
+  return Query<CrlModelPtr>(DB_CALL_TIME("GetActualCrl"),
+                            queries::GET_ACTUAL_CRL,
+                            PqParams().Hex(caSerial).Int32(partition),
+                            [](const PqResult &rows) -> CrlModelPtr {
+                              if (rows.Empty())
+                                return nullptr;
+                              return ReadCrl(rows, 0);
+                            });
+}
+
+CertificateModelPtr AsyncPgDatabase::GetCertificate(const std::string &serial) {
+  tracing::ScopedSpan span("db.GetCertificate");
+  return GetCertificateAsync(serial).get();
+}
+
+std::vector<CertificateModelPtr>
+AsyncPgDatabase::GetCertificates(const std::string &caSerial) {
+  tracing::ScopedSpan span("db.GetCertificates");
+  return GetCertificatesAsync(caSerial).get();
+}
+
+std::vector<CertificateModelPtr> AsyncPgDatabase::GetAllCertificates() {
+  tracing::ScopedSpan span("db.GetAllCertificates");
+  return GetAllCertificatesAsync().get();
+}
+
+std::vector<CertificateModelPtr>
+AsyncPgDatabase::GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                                     std::int32_t partition,
+                                                     const DateTime &validAt) {
+  tracing::ScopedSpan span("db.GetRevokedListOrderByRevokeDateDesc");
+  return GetRevokedListOrderByRevokeDateDescAsync(caSerial, partition, validAt)
+      .get();
+}
+
+CertificateModelPtr AsyncPgDatabase::GetLastRevoked(const std::string &caSerial,
+                                                    std::int32_t partition) {
+  tracing::ScopedSpan span("db.GetLastRevoked");
+  return GetLastRevokedAsync(caSerial, partition).get();
+}
+
+CertificateAuthorityModelPtr AsyncPgDatabase::GetCa(const std::string &serial) {
+  tracing::ScopedSpan span("db.GetCa");
+  return GetCaAsync(serial).get();
+}
+
+CertificateAuthorityMetadataModelPtr
+AsyncPgDatabase::GetCaMetadata(const std::string &serial) {
+  tracing::ScopedSpan span("db.GetCaMetadata");
+  return GetCaMetadataAsync(serial).get();
+}
+
+std::vector<CertificateAuthorityMetadataModelPtr> AsyncPgDatabase::GetAllCa() {
+  tracing::ScopedSpan span("db.GetAllCa");
+  return GetAllCaAsync().get();
+}
+
+std::vector<std::byte>
+AsyncPgDatabase::GetCaCertificateData(const std::string &serial) {
+  tracing::ScopedSpan span("db.GetCaCertificateData");
+  return GetCaCertificateDataAsync(serial).get();
+}
+
+void AsyncPgDatabase::AddCertificate(const CertificateModel &cert) {
+  tracing::ScopedSpan span("db.AddCertificate");
+  AddCertificateAsync(cert).get();
+}
+
+void AsyncPgDatabase::AddCA(const CertificateAuthorityModel &ca) {
+  tracing::ScopedSpan span("db.AddCA");
+  AddCAAsync(ca).get();
+}
+
+void AsyncPgDatabase::MakeCertificateRevoked(const std::string &serial,
+                                             const DateTime revokeDate) {
+  tracing::ScopedSpan span("db.MakeCertificateRevoked");
+  MakeCertificateRevokedAsync(serial, revokeDate).get();
+}
+
+void AsyncPgDatabase::AddCrl(const CrlModel &crl) {
+  tracing::ScopedSpan span("db.AddCrl");
+  AddCrlAsync(crl).get();
+}
+
+CrlModelPtr AsyncPgDatabase::GetActualCrl(const std::string &caSerial,
+                                          std::int32_t partition) {
+  tracing::ScopedSpan span("db.GetActualCrl");
+  return GetActualCrlAsync(caSerial, partition).get();
+}
+
+bool AsyncPgDatabase::TryWithCrlLock(const std::string &caSerial,
+                                     std::int32_t partition,
+                                     std::chrono::milliseconds wait,
+                                     const std::function<void()> &generate) {
+  // session lock needs its own connection, pipelined ones are shared
+  PqConnectionScope scope(_lockPool);
+  return with_crl_lock(*scope.GetConnection(), caSerial, partition, wait,
+                       generate);
+}
+
+bool AsyncPgDatabase::ClaimIdempotencyKey(const IdempotencyModel &model) {
+  tracing::ScopedSpan span("db.ClaimIdempotencyKey");
+  return Query<bool>(DB_CALL_TIME("ClaimIdempotencyKey"),
+                     queries::CLAIM_IDEMPOTENCY_KEY,
+                     PqParams()
+                         .Text(model.key)
+                         .Text(model.fingerprint)
+                         .Timestamp(model.expireDate),
+                     [](const PqResult &rows) { return !rows.Empty(); })
+      .get();
+}
+
+IdempotencyModelPtr
+AsyncPgDatabase::GetIdempotencyKey(const std::string &key) {
+  tracing::ScopedSpan span("db.GetIdempotencyKey");
+  return Query<IdempotencyModelPtr>(
+             DB_CALL_TIME("GetIdempotencyKey"), queries::GET_IDEMPOTENCY_KEY,
+             PqParams().Text(key),
+             [](const PqResult &rows) -> IdempotencyModelPtr {
+               if (rows.Empty())
+                 return nullptr;
+               return ReadIdempotency(rows, 0);
+             })
+      .get();
+}
+
+void AsyncPgDatabase::CompleteIdempotencyKey(const IdempotencyModel &model) {
+  tracing::ScopedSpan span("db.CompleteIdempotencyKey");
+  Query<void>(DB_CALL_TIME("CompleteIdempotencyKey"),
+              queries::COMPLETE_IDEMPOTENCY_KEY,
+              PqParams()
+                  .Text(model.key)
+                  .Timestamp(model.expireDate)
+                  .Hex(model.serial),
+              Ignore)
+      .get();
+}
+
+void AsyncPgDatabase::DeleteIdempotencyKey(const std::string &key) {
+  tracing::ScopedSpan span("db.DeleteIdempotencyKey");
+  Query<void>(DB_CALL_TIME("DeleteIdempotencyKey"),
+              queries::DELETE_IDEMPOTENCY_KEY, PqParams().Text(key), Ignore)
+      .get();
+}
+
+void AsyncPgDatabase::DeleteExpiredIdempotencyKeys(const DateTime &now) {
+  tracing::ScopedSpan span("db.DeleteExpiredIdempotencyKeys");
+  Query<void>(DB_CALL_TIME("DeleteExpiredIdempotencyKeys"),
+              queries::DELETE_EXPIRED_IDEMPOTENCY_KEYS,
+              PqParams().Timestamp(now), Ignore)
+      .get();
+}
@@ -0,0 +1,108 @@
+#ifndef _CASERV_POSTGRE_ASYNC_PGDATABASE_H_
+#define _CASERV_POSTGRE_ASYNC_PGDATABASE_H_
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./../common/metrics.h"
+#include "./../db/iasync_database.h"
+#include "./../db/idatabase.h"
+#include "connection_pool.h"
+#include "pq_pipeline.h"
+
+namespace postgre {
+
+using namespace db;
+using namespace db::models;
+
+/*
+    PostgreSQL database over libpq pipeline mode. Queries of all callers
+    share a few connections, many of them are in flight at once. Blocking
+    IDataBase methods wait for the future of the async call.
+*/
+class AsyncPgDatabase : public IAsyncDataBase, public IDataBase {
+public:
+  AsyncPgDatabase(const std::string_view &connectionString,
+                  std::size_t connections);
+  ~AsyncPgDatabase();
+
+  std::future<void> AddCertificateAsync(const CertificateModel &cert) override;
+  std::future<CertificateModelPtr>
+  GetCertificateAsync(const std::string &serial) override;
+  std::future<std::vector<CertificateModelPtr>>
+  GetCertificatesAsync(const std::string &caSerial) override;
+  std::future<std::vector<CertificateModelPtr>> GetAllCertificatesAsync() override;
+  std::future<void> AddCAAsync(const CertificateAuthorityModel &ca) override;
+  std::future<CertificateAuthorityModelPtr>
+  GetCaAsync(const std::string &serial) override;
+  std::future<CertificateAuthorityMetadataModelPtr>
+  GetCaMetadataAsync(const std::string &serial) override;
+  std::future<std::vector<CertificateAuthorityMetadataModelPtr>>
+  GetAllCaAsync() override;
+  std::future<std::vector<std::byte>>
+  GetCaCertificateDataAsync(const std::string &serial) override;
+  std::future<void> AddCrlAsync(const CrlModel &crl) override;
+  std::future<CrlModelPtr> GetActualCrlAsync(const std::string &caSerial,
+                                             std::int32_t partition) override;
+  std::future<void> MakeCertificateRevokedAsync(const std::string &serial,
+                                                const DateTime revokeDate) override;
+  std::future<std::vector<CertificateModelPtr>>
+  GetRevokedListOrderByRevokeDateDescAsync(const std::string &caSerial,
+                                           std::int32_t partition,
+                                           const DateTime &validAt) override;
+  std::future<CertificateModelPtr>
+  GetLastRevokedAsync(const std::string &caSerial,
+                      std::int32_t partition) override;
+
+  CertificateModelPtr GetCertificate(const std::string &serial) override;
+  std::vector<CertificateModelPtr>
+  GetCertificates(const std::string &caSerial) override;
+  std::vector<CertificateModelPtr> GetAllCertificates() override;
+  CertificateAuthorityModelPtr GetCa(const std::string &serial) override;
+  CertificateAuthorityMetadataModelPtr
+  GetCaMetadata(const std::string &serial) override;
+  std::vector<CertificateAuthorityMetadataModelPtr> GetAllCa() override;
+  std::vector<std::byte> GetCaCertificateData(const std::string &serial) override;
+  void AddCertificate(const CertificateModel &cert) override;
+  void AddCA(const CertificateAuthorityModel &ca) override;
+
+  void MakeCertificateRevoked(const std::string &serial,
+                              const DateTime revokeDate) override;
+  std::vector<CertificateModelPtr>
+  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                      std::int32_t partition,
+                                      const DateTime &validAt) override;
+  CertificateModelPtr GetLastRevoked(const std::string &caSerial,
+                                     std::int32_t partition) override;
+
+  void AddCrl(const CrlModel &crl) override;
+  CrlModelPtr GetActualCrl(const std::string &caSerial,
+                           std::int32_t partition) override;
+  bool TryWithCrlLock(const std::string &caSerial, std::int32_t partition,
+                      std::chrono::milliseconds wait,
+                      const std::function<void()> &generate) override;
+  bool ClaimIdempotencyKey(const IdempotencyModel &model) override;
+  IdempotencyModelPtr GetIdempotencyKey(const std::string &key) override;
+  void CompleteIdempotencyKey(const IdempotencyModel &model) override;
+  void DeleteIdempotencyKey(const std::string &key) override;
+  void DeleteExpiredIdempotencyKeys(const DateTime &now) override;
+
+private:
+  // read converts result on the event loop thread, time is recorded on
+  // completion
+  template <typename TResult, typename TRead>
+  std::future<TResult> Query(metrics::Histogram &time, const char *sql,
+                             PqParams params, TRead read);
+
+  PqPipelinePtr _pipeline;
+  // sessions holding CRL locks
+  PqConnectionPoolPtr _lockPool;
+};
+
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_ASYNC_PGDATABASE_H_
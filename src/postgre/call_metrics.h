@@ -0,0 +1,21 @@
+#ifndef _CASERV_POSTGRE_CALL_METRICS_H_
+#define _CASERV_POSTGRE_CALL_METRICS_H_
+
+#include "./../common/metrics.h"
+#include "./../common/tracing.h"
+
+// caserv_db_call_seconds histogram of method, registered once per call site
+#define DB_CALL_TIME(method)                                                   \
+  []() -> metrics::Histogram & {                                               \
+    static auto &time = metrics::histogram(                                    \
+        "caserv_db_call_seconds", "Database call duration by method.",        \
+        {{"method", method}});                                                 \
+    return time;                                                               \
+  }()
+
+// times and traces the rest of the enclosing scope
+#define DB_CALL_TIMER(method)                                                  \
+  metrics::ScopedTimer dbCallTimer(DB_CALL_TIME(method));                      \
+  tracing::ScopedSpan dbSpan("db." method)
+
+#endif //_CASERV_POSTGRE_CALL_METRICS_H_
@@ -10,21 +10,29 @@
 #include <queue>
 #include <string_view>
 
-namespace postgre {
+#include "./../common/metrics.h"
+#include "./../common/tracing.h"
+#include "pq_connection.h"
 
-using ConnectionPtr = std::shared_ptr<pqxx::connection>;
+namespace postgre {
 
-class ConnectionPool {
+template <typename TConnection> class BasicConnectionPool {
 public:
-  ConnectionPool(const std::string_view &connectionString, long poolSize) {
+  using ConnectionPtr = std::shared_ptr<TConnection>;
+
+  BasicConnectionPool(const std::string_view &connectionString, long poolSize) {
     std::lock_guard<std::mutex> lock(_mutex);
     for(auto i = 0; i < poolSize; i++) {
-        _connections.emplace(std::make_shared<pqxx::connection>(connectionString.data()));
+        _connections.emplace(std::make_shared<TConnection>(connectionString.data()));
     }
   }
-  ~ConnectionPool() {}
-  
+  ~BasicConnectionPool() {}
+
   ConnectionPtr GetConnection() {
+    static auto &waitTime = metrics::histogram(
+        "caserv_db_pool_wait_seconds", "Time to acquire pooled connection.");
+    metrics::ScopedTimer timer(waitTime);
+    tracing::ScopedSpan span("db.pool_wait");
     std::unique_lock<std::mutex> lock(_mutex);
     while(_connections.empty()) {
         _conditon.wait(lock);
@@ -47,15 +55,16 @@ private:
   std::condition_variable _conditon;
 };
 
-using ConnectionPoolPtr = std::shared_ptr<ConnectionPool>;
-
-class ConnectionScope {
+template <typename TConnection> class BasicConnectionScope {
 public:
-  ConnectionScope(ConnectionPoolPtr connectionPool)  : _connectionPool(connectionPool) {
+  using ConnectionPoolPtr = std::shared_ptr<BasicConnectionPool<TConnection>>;
+  using ConnectionPtr = std::shared_ptr<TConnection>;
+
+  BasicConnectionScope(ConnectionPoolPtr connectionPool)  : _connectionPool(connectionPool) {
     _connection = _connectionPool->GetConnection();
   }
 
-  ~ConnectionScope() {
+  ~BasicConnectionScope() {
     if(_connection != nullptr) {
       _connectionPool->FreeConnection(_connection);
     }
@@ -64,11 +73,23 @@ public:
   ConnectionPtr GetConnection() {
     return _connection;
   }
-  
+
 private:
   ConnectionPoolPtr _connectionPool{nullptr};
   ConnectionPtr _connection;
 };
+
+// pqxx connections, text results
+using ConnectionPtr = std::shared_ptr<pqxx::connection>;
+using ConnectionPool = BasicConnectionPool<pqxx::connection>;
+using ConnectionPoolPtr = std::shared_ptr<ConnectionPool>;
+using ConnectionScope = BasicConnectionScope<pqxx::connection>;
+
+// raw libpq connections, binary results
+using PqConnectionPool = BasicConnectionPool<PqConnection>;
+using PqConnectionPoolPtr = std::shared_ptr<PqConnectionPool>;
+using PqConnectionScope = BasicConnectionScope<PqConnection>;
+
 } // namespace postgre
 
-#endif //_CASERV_POSTGRE_CONENCTION_POOL_H_
\ No newline at end of file
+#endif //_CASERV_POSTGRE_CONENCTION_POOL_H_
@@ -1,5 +1,6 @@
 #include "connection_pool.h"
 #include <cstddef>
+#include <chrono>
 #include <cstdint>
 #include <exception>
 #include <memory>
@@ -11,49 +12,132 @@
 #include <string_view>
 #include <vector>
 
+#include "advisory_lock.h"
+#include "call_metrics.h"
 #include "pgdatabase.h"
+#include "pq_readers.h"
+#include "queries.h"
 #include "type_spesc/datetime_spec.h"
+#include "./../common/hex.h"
 #include "./../common/logger.h"
+#include "./../common/metrics.h"
+#include "./../common/tracing.h"
 
 
 using namespace postgre;
 
-PgDatabase::PgDatabase(const std::string_view &connectionString) {
+using Clock = std::chrono::steady_clock;
+
+// replica lag is checked at most this often
+static constexpr auto REPLICA_CHECK_INTERVAL =
+    std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1));
+
+// reads of a thread go to primary for max replica lag after its write
+// (read-your-writes for the request) and while PrimaryReads is alive
+static thread_local Clock::time_point lastWrite{};
+static thread_local int primaryReads = 0;
+
+// serials and thumbprints are stored as bytea, malformed hex is not
+// written as an empty value
+static std::vector<std::byte> HexBytes(const std::string_view &value) {
+  auto bytes = hex::decode(value);
+  if (bytes.empty())
+    throw std::runtime_error("Serial or thumbprint is not hex.");
+  return bytes;
+}
+
+static auto Binary(const std::vector<std::byte> &bytes) {
+  return pqxx::binary_cast(bytes.data(), bytes.size());
+}
+
+static std::int64_t Ticks(Clock::time_point time) {
+  return time.time_since_epoch().count();
+}
+
+PgDatabase::PrimaryReads::PrimaryReads() { ++primaryReads; }
+PgDatabase::PrimaryReads::~PrimaryReads() { --primaryReads; }
+
+PgDatabase::PgDatabase(const std::string_view &connectionString,
+                       const std::string_view &replicaConnectionString,
+                       std::chrono::milliseconds maxReplicaLag)
+    : _maxReplicaLag(maxReplicaLag) {
   _connectionPool = std::make_shared<ConnectionPool>(connectionString, 10);
+  _readPool = std::make_shared<PqConnectionPool>(connectionString, 10);
+  _lockPool =
+      std::make_shared<PqConnectionPool>(connectionString, CRL_LOCK_CONNECTIONS);
+  if (replicaConnectionString.empty())
+    return;
+  try {
+    _replicaPool = std::make_shared<PqConnectionPool>(replicaConnectionString, 10);
+  } catch (const std::exception &ex) {
+    LOG_ERROR("Replica is not available, reads use primary: {}", ex.what());
+  }
+}
+
+void PgDatabase::MarkWrite() { lastWrite = Clock::now(); }
+
+bool PgDatabase::UseReplica() const {
+  if (_replicaPool == nullptr || primaryReads > 0)
+    return false;
+  auto now = Clock::now();
+  return now - lastWrite > _maxReplicaLag &&
+         Ticks(now) >= _replicaSkipUntil.load(std::memory_order_relaxed);
+}
+
+void PgDatabase::SkipReplica() {
+  _replicaSkipUntil.store(Ticks(Clock::now() + REPLICA_CHECK_INTERVAL),
+                          std::memory_order_relaxed);
+}
+
+bool PgDatabase::ReplicaInSync(PqConnection &conn) {
+  auto now = Clock::now();
+  auto checkedAt = _replicaCheckedAt.load(std::memory_order_relaxed);
+  if (Ticks(now) < checkedAt + REPLICA_CHECK_INTERVAL.count())
+    return true;
+  if (!_replicaCheckedAt.compare_exchange_strong(checkedAt, Ticks(now)))
+    return true;
+  auto lag = std::chrono::milliseconds(
+      conn.ExecBinary(queries::REPLICA_LAG_MS).GetInt64(0, 0));
+  if (lag <= _maxReplicaLag)
+    return true;
+  LOG_WARNING("Replica lag {} ms, reads use primary.", lag.count());
+  SkipReplica();
+  return false;
+}
+
+PqResult PgDatabase::Read(const char *query, const PqParams &params) {
+  if (UseReplica()) {
+    static auto &fallbacks = metrics::counter(
+        "caserv_db_replica_fallbacks_total",
+        "Replica reads repeated on primary (not found, lag or error).");
+    try {
+      PqConnectionScope scope(_replicaPool);
+      auto conn = scope.GetConnection();
+      if (ReplicaInSync(*conn)) {
+        auto rows = conn->ExecBinary(query, params);
+        if (!rows.Empty())
+          return rows;
+        // row may not be replicated yet
+      }
+    } catch (const std::exception &ex) {
+      LOG_WARNING("Replica read failed, reads use primary: {}", ex.what());
+      SkipReplica();
+    }
+    fallbacks.Increment();
+  }
+  PqConnectionScope scope(_readPool);
+  return scope.GetConnection()->ExecBinary(query, params);
 }
 
 PgDatabase::~PgDatabase() {}
 
 CertificateModelPtr PgDatabase::GetCertificate(const std::string &certSerial) {
+  DB_CALL_TIMER("GetCertificate");
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    static auto query = "SELECT \"serial\", \"thumbprint\", \"caSerial\", "
-                        "\"commonName\", \"issueDate\", \"revokeDate\" "
-                        "FROM certificates "
-                        "WHERE UPPER(\"serial\") = UPPER($1) "
-                        "ORDER BY \"issueDate\" LIMIT 1";
-    pqxx::work tran(*conn);
-
-    std::vector<CertificateModelPtr> result;
-    for (auto [serial, thumbprint, caSerial, commonName, issueDate,
-               revokeDate] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    std::string_view, DateTimePtr, DateTimePtr>(query,
-                                                                {certSerial})) {
-      auto model = std::make_shared<CertificateModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->caSerial = caSerial;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->revokeDate = revokeDate;
-      result.push_back(model);
-    }
-    tran.commit();
-    if (result.empty())
+    auto rows = Read(queries::GET_CERTIFICATE, PqParams().Hex(certSerial));
+    if (rows.Empty())
       return nullptr;
-    return result[0];
+    return share_row(ReadCertificates(rows), 0);
 
   } catch (const std::exception &ex) {
     LOG_ERROR("{}", ex.what());
@@ -65,330 +149,257 @@ CertificateModelPtr PgDatabase::GetCertificate(const std::string &certSerial) {
 
 std::vector<CertificateModelPtr>
 PgDatabase::GetCertificates(const std::string &caSerial) {
+  DB_CALL_TIMER("GetCertificates");
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    std::vector<CertificateModelPtr> result;
-    static auto query = "SELECT \"serial\", \"thumbprint\", \"caSerial\", "
-                        "\"commonName\", \"issueDate\", \"revokeDate\" "
-                        "FROM certificates "
-                        "WHERE UPPER(\"caSerial\") = UPPER($1)";
-    pqxx::work tran(*conn);
-
-    for (auto [serial, thumbprint, caSerial, commonName, issueDate,
-               revokeDate] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    std::string_view, DateTimePtr, DateTimePtr>(query,
-                                                                {caSerial})) {
-      auto model = std::make_shared<CertificateModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->caSerial = caSerial;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->revokeDate = revokeDate;
-      result.push_back(model);
-    }
-    tran.commit();
-    return result;
+    auto rows = Read(queries::GET_CERTIFICATES, PqParams().Hex(caSerial));
+    return share_rows(ReadCertificates(rows));
   } catch (...) {
     throw;
   }
 }
 
 std::vector<CertificateModelPtr> PgDatabase::GetAllCertificates() {
+  DB_CALL_TIMER("GetAllCertificates");
   try {
-    std::vector<CertificateModelPtr> result;
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    static auto query = "SELECT \"serial\", \"thumbprint\", \"caSerial\", "
-                        "\"commonName\", \"issueDate\", \"revokeDate\" "
-                        "FROM certificates";
-    pqxx::work tran(*conn);
-
-    for (auto [serial, thumbprint, caSerial, commonName, issueDate,
-               revokeDate] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    std::string_view, DateTimePtr, DateTimePtr>(query)) {
-      auto model = std::make_shared<CertificateModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->caSerial = caSerial;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->revokeDate = revokeDate;
-      result.push_back(model);
-    }
-    tran.commit();
-    return result;
+    return share_rows(ReadCertificates(Read(queries::GET_ALL_CERTIFICATES)));
   } catch (...) {
     throw;
   }
 }
 
 std::vector<CertificateModelPtr>
-PgDatabase::GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial) {
+PgDatabase::GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                                std::int32_t partition,
+                                                const DateTime &validAt) {
+  DB_CALL_TIMER("GetRevokedListOrderByRevokeDateDesc");
   try {
-    std::vector<CertificateModelPtr> result;
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    static auto query =
-        "SELECT \"serial\", \"thumbprint\", \"caSerial\", "
-        "\"commonName\", \"issueDate\", \"revokeDate\" "
-        "FROM certificates "
-        "WHERE \"revokeDate\" IS NOT NULL AND UPPER(\"caSerial\") = UPPER($1)";
-    pqxx::work tran(*conn);
-
-    for (auto [serial, thumbprint, caSerial, commonName, issueDate,
-               revokeDate] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    std::string_view, DateTimePtr, DateTimePtr>(query,
-                                                                {caSerial})) {
-      auto model = std::make_shared<CertificateModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->caSerial = caSerial;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->revokeDate = revokeDate;
-      result.push_back(model);
-    }
-    tran.commit();
-    return result;
+    auto rows = Read(queries::GET_REVOKED, PqParams()
+                                               .Hex(caSerial)
+                                               .Int32(partition)
+                                               .Timestamp(validAt));
+    return share_rows(ReadRevoked(rows));
   } catch (...) {
     throw;
   }
 }
 
-CertificateModelPtr PgDatabase::GetLastRevoked(const std::string &caSerial) {
+CertificateModelPtr PgDatabase::GetLastRevoked(const std::string &caSerial,
+                                               std::int32_t partition) {
+  DB_CALL_TIMER("GetLastRevoked");
+  // CRL actuality check, a revocation made through another thread or
+  // instance must be seen at once
+  PrimaryReads primary;
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    static auto query =
-        "SELECT \"serial\", \"thumbprint\", \"caSerial\", "
-        "\"commonName\", \"issueDate\", \"revokeDate\" "
-        "FROM certificates "
-        "WHERE \"revokeDate\" IS NOT NULL AND UPPER(\"caSerial\") = UPPER($1) "
-        "ORDER BY \"revokeDate\" DESC LIMIT 1";
-    pqxx::work tran(*conn);
-    std::vector<CertificateModelPtr> result;
-
-    for (auto [serial, thumbprint, caSerial, commonName, issueDate,
-               revokeDate] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    std::string_view, DateTimePtr, DateTimePtr>(query,
-                                                                {caSerial})) {
-      auto model = std::make_shared<CertificateModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->caSerial = caSerial;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->revokeDate = revokeDate;
-      result.push_back(model);
-    }
-    if (result.empty())
+    auto rows = Read(queries::GET_LAST_REVOKED,
+                     PqParams().Hex(caSerial).Int32(partition));
+    if (rows.Empty())
       return nullptr;
-    return result[0];
+    return share_row(ReadCertificates(rows), 0);
   } catch (...) {
     throw;
   }
 }
 
 CertificateAuthorityModelPtr PgDatabase::GetCa(const std::string &serial) {
+  DB_CALL_TIMER("GetCa");
 
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    static auto query =
-        "SELECT \"serial\", \"thumbprint\", \"commonName\", "
-        "\"issueDate\", \"certificate\", \"privateKey\", \"publicUrl\" "
-        "FROM ca "
-        "WHERE UPPER(\"serial\") = UPPER($1) "
-        "ORDER BY \"issueDate\" LIMIT 1";
-    pqxx::work tran(*conn);
-
-    std::vector<CertificateAuthorityModelPtr> result;
-    for (auto [serial, thumbprint, commonName, issueDate, certificate,
-               privateKey, publicUrl] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    DateTimePtr, pqxx::bytes, pqxx::bytes, std::string_view>(
-             query, {serial})) {
-      auto model = std::make_shared<CertificateAuthorityModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->certificate =
-          std::vector<std::byte>(certificate.begin(), certificate.end());
-      model->privateKey =
-          std::vector<std::byte>(privateKey.begin(), privateKey.end());
-      model->publicUrl = publicUrl;
-      result.push_back(model);
-    }
-    tran.commit();
-    if (result.empty())
+    auto rows = Read(queries::GET_CA, PqParams().Hex(serial));
+    if (rows.Empty())
       return nullptr;
-    return result[0];
+    return ReadCa(rows, 0);
   } catch (...) {
     throw;
   }
 }
 
-std::vector<CertificateAuthorityModelPtr> PgDatabase::GetAllCa() {
+CertificateAuthorityMetadataModelPtr
+PgDatabase::GetCaMetadata(const std::string &serial) {
+  DB_CALL_TIMER("GetCaMetadata");
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    std::vector<CertificateAuthorityModelPtr> result;
-    static auto query =
-        "SELECT \"serial\", \"thumbprint\", \"commonName\", "
-        "\"issueDate\", \"certificate\", \"privateKey\", \"publicUrl\" "
-        "FROM ca";
-    pqxx::work tran(*conn);
+    auto rows = Read(queries::GET_CA_METADATA, PqParams().Hex(serial));
+    if (rows.Empty())
+      return nullptr;
+    return share_row(ReadCaMetadata(rows), 0);
+  } catch (...) {
+    throw;
+  }
+}
 
-    for (auto [serial, thumbprint, commonName, issueDate, certificate,
-               privateKey, publicUrl] :
-         tran.query<std::string_view, std::string_view, std::string_view,
-                    DateTimePtr, pqxx::bytes, pqxx::bytes, std::string_view>(
-             query)) {
-      auto model = std::make_shared<CertificateAuthorityModel>();
-      model->serial = serial;
-      model->thumbprint = thumbprint;
-      model->commonName = commonName;
-      model->issueDate = issueDate;
-      model->certificate =
-          std::vector<std::byte>(certificate.begin(), certificate.end());
-      model->privateKey =
-          std::vector<std::byte>(privateKey.begin(), privateKey.end());
-      model->publicUrl = publicUrl;
-      result.push_back(model);
-    }
-    tran.commit();
-    return result;
+std::vector<CertificateAuthorityMetadataModelPtr> PgDatabase::GetAllCa() {
+  DB_CALL_TIMER("GetAllCa");
+  try {
+    return share_rows(ReadCaMetadata(Read(queries::GET_ALL_CA)));
   } catch (...) {
     throw;
   }
 }
 
 std::vector<std::byte> PgDatabase::GetCaCertificateData(const std::string &serial){
+  DB_CALL_TIMER("GetCaCertificateData");
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    std::vector<std::byte> result;
-    static auto query =
-        "SELECT \"certificate\" "
-        "FROM ca "
-        "WHERE UPPER(\"serial\") = UPPER($1) "
-        "ORDER BY \"issueDate\" LIMIT 1";
-    pqxx::work tran(*conn);
-
-    for (auto [content] :
-         tran.query<pqxx::bytes>(query, serial)) {
-      auto model = std::make_shared<CertificateAuthorityModel>();
-      result = std::vector<std::byte>(content.begin(), content.end());
-    }
-    tran.commit();
-    return result;
+    auto rows = Read(queries::GET_CA_CERTIFICATE_DATA, PqParams().Hex(serial));
+    if (rows.Empty())
+      return std::vector<std::byte>();
+    return ReadBytes(rows, 0, 0);
   } catch (...) {
     throw;
   }
 }
 
 void PgDatabase::AddCertificate(const CertificateModel &cert) {
+  DB_CALL_TIMER("AddCertificate");
   try {
     ConnectionScope scope(_connectionPool);
     auto conn = scope.GetConnection();
-    static auto query =
-        "INSERT INTO certificates(\"serial\", \"thumbprint\", \"caSerial\", "
-        "\"commonName\", \"issueDate\", \"revokeDate\") "
-        "VALUES ($1, $2, $3, $4, $5, $6)";
+    auto serial = HexBytes(cert.serial);
+    auto thumbprint = HexBytes(cert.thumbprint);
+    auto caSerial = HexBytes(cert.caSerial);
     pqxx::work tran(*conn);
-    tran.exec_params(query, cert.serial,
-                                     cert.thumbprint, cert.caSerial,
-                                     cert.commonName, cert.issueDate, nullptr);
+    tran.exec_params(queries::ADD_CERTIFICATE, Binary(serial),
+                     Binary(thumbprint), Binary(caSerial), cert.commonName,
+                     cert.issueDate, nullptr, cert.expireDate,
+                     cert.crlPartition);
     tran.commit();
+    MarkWrite();
   } catch (...) {
     throw;
   }
 }
 
 void PgDatabase::AddCA(const CertificateAuthorityModel &ca) {
+  DB_CALL_TIMER("AddCA");
   try {
     ConnectionScope scope(_connectionPool);
     auto conn = scope.GetConnection();
-    static auto query =
-        "INSERT INTO ca(\"serial\", \"thumbprint\", \"commonName\", "
-        "\"issueDate\", \"certificate\", \"privateKey\", \"publicUrl\" ) "
-        "VALUES ($1, $2, $3, $4, $5, $6, $7)";
+    auto serial = HexBytes(ca.serial);
+    auto thumbprint = HexBytes(ca.thumbprint);
     pqxx::work tran(*conn);
-    tran.exec_params(query, ca.serial, ca.thumbprint, ca.commonName, ca.issueDate,
+    tran.exec_params(queries::ADD_CA, Binary(serial), Binary(thumbprint), ca.commonName, ca.issueDate,
         pqxx::binary_cast(ca.certificate.data(), ca.certificate.size()),
         pqxx::binary_cast(ca.privateKey.data(), ca.privateKey.size()),
         ca.publicUrl);
     tran.commit();
+    MarkWrite();
   } catch (...) {
     throw;
   }
 }
 
 void PgDatabase::MakeCertificateRevoked(const std::string &serial,
-                                        const DateTimePtr revokeDate) {
+                                        const DateTime revokeDate) {
+  DB_CALL_TIMER("MakeCertificateRevoked");
   try {
     ConnectionScope scope(_connectionPool);
     auto conn = scope.GetConnection();
-    static auto query = "UPDATE certificates SET \"revokeDate\" = $1"
-                        "WHERE UPPER(serial) = UPPER($2)";
+    auto serialBytes = HexBytes(serial);
     pqxx::work tran(*conn);
-    tran.exec_params(query, revokeDate, serial);
+    tran.exec_params(queries::MAKE_CERTIFICATE_REVOKED, revokeDate,
+                     Binary(serialBytes));
     tran.commit();
+    MarkWrite();
   } catch (...) {
     throw;
   }
 }
 
 void PgDatabase::AddCrl(const CrlModel &crl) {
+  DB_CALL_TIMER("AddCrl");
   try {
     ConnectionScope scope(_connectionPool);
     auto conn = scope.GetConnection();
-    static auto query = "INSERT INTO crl(\"caSerial\", \"number\", "
-                        "\"issueDate\", \"expireDate\", \"lastSerial\", \"content\") "
-                        "VALUES ($1, $2, $3, $4, $5, $6)";
+    auto caSerial = HexBytes(crl.caSerial);
+    // empty when CA has no revocations
+    auto lastSerial = hex::decode(crl.lastSerial);
     pqxx::work tran(*conn);
-    tran.exec_params(query, crl.caSerial, crl.number, crl.issueDate, crl.expireDate, crl.lastSerial,
+    tran.exec_params(queries::ADD_CRL, Binary(caSerial), crl.partition, crl.number, crl.issueDate, crl.expireDate, Binary(lastSerial),
         pqxx::binary_cast(crl.content.data(), crl.content.size()));
     tran.commit();
+    MarkWrite();
 
   } catch (...) {
     throw;
   }
 }
-CrlModelPtr PgDatabase::GetActualCrl(const std::string &caSerial) {
+CrlModelPtr PgDatabase::GetActualCrl(const std::string &caSerial,
+                                     std::int32_t partition) {
+  DB_CALL_TIMER("GetActualCrl");
+  // replica could serve a CRL older than the last revocation and make the
+  // next number collide
+  PrimaryReads primary;
   try {
-    ConnectionScope scope(_connectionPool);
-    auto conn = scope.GetConnection();
-    std::vector<CrlModelPtr> result;
-    static auto query = "SELECT \"caSerial\", \"number\", \"issueDate\", "
-                        "\"expireDate\", \"lastSerial\", \"content\" "
-                        "FROM crl "
-                        "WHERE UPPER(\"caSerial\") = UPPER($1)"
-                        "ORDER BY number DESC LIMIT 1";
-    pqxx::work tran(*conn);
-    for (auto [caSerial, number, issueDate, expireDate, lastSerial, content] :
-         tran.query<std::string_view, long, DateTimePtr, DateTimePtr, std::string_view,
-                    pqxx::bytes>(query, caSerial)) {
-      auto model = std::make_shared<CrlModel>();
-      model->caSerial = caSerial;
-      model->number = number;
-      model->issueDate = issueDate;
-      model->expireDate = expireDate;
-      model->lastSerial = lastSerial;
-      model->content = std::vector(content.begin(), content.end());
-      result.push_back(model);
-    }
-    if (result.empty())
+    auto rows = Read(queries::GET_ACTUAL_CRL,
+                     PqParams().Hex(caSerial).Int32(partition));
+    if (rows.Empty())
       return nullptr;
-    return result[0];
+    return ReadCrl(rows, 0);
   } catch (...) {
     throw;
   }
 }
+
+bool PgDatabase::TryWithCrlLock(const std::string &caSerial,
+                                std::int32_t partition,
+                                std::chrono::milliseconds wait,
+                                const std::function<void()> &generate) {
+  // lock is held by the session for the whole generate, a read pool
+  // connection would starve reads of generate when pool size generations
+  // run at once
+  PqConnectionScope scope(_lockPool);
+  // CRL number is taken from the actual CRL, replica may lag behind
+  PrimaryReads primary;
+  return with_crl_lock(*scope.GetConnection(), caSerial, partition, wait,
+                       generate);
+}
+
+bool PgDatabase::ClaimIdempotencyKey(const IdempotencyModel &model) {
+  DB_CALL_TIMER("ClaimIdempotencyKey");
+  ConnectionScope scope(_connectionPool);
+  auto conn = scope.GetConnection();
+  pqxx::work tran(*conn);
+  auto rows = tran.exec_params(queries::CLAIM_IDEMPOTENCY_KEY, model.key,
+                               model.fingerprint, model.expireDate);
+  tran.commit();
+  MarkWrite();
+  return !rows.empty();
+}
+
+IdempotencyModelPtr PgDatabase::GetIdempotencyKey(const std::string &key) {
+  DB_CALL_TIMER("GetIdempotencyKey");
+  // pending keys are polled by other instances, replica may not have them
+  PrimaryReads primary;
+  auto rows = Read(queries::GET_IDEMPOTENCY_KEY, PqParams().Text(key));
+  if (rows.Empty())
+    return nullptr;
+  return ReadIdempotency(rows, 0);
+}
+
+void PgDatabase::CompleteIdempotencyKey(const IdempotencyModel &model) {
+  DB_CALL_TIMER("CompleteIdempotencyKey");
+  ConnectionScope scope(_connectionPool);
+  auto conn = scope.GetConnection();
+  pqxx::work tran(*conn);
+  tran.exec_params(queries::COMPLETE_IDEMPOTENCY_KEY, model.key,
+                   model.expireDate, Binary(HexBytes(model.serial)));
+  tran.commit();
+  MarkWrite();
+}
+
+void PgDatabase::DeleteIdempotencyKey(const std::string &key) {
+  DB_CALL_TIMER("DeleteIdempotencyKey");
+  ConnectionScope scope(_connectionPool);
+  auto conn = scope.GetConnection();
+  pqxx::work tran(*conn);
+  tran.exec_params(queries::DELETE_IDEMPOTENCY_KEY, key);
+  tran.commit();
+  MarkWrite();
+}
+
+void PgDatabase::DeleteExpiredIdempotencyKeys(const DateTime &now) {
+  DB_CALL_TIMER("DeleteExpiredIdempotencyKeys");
+  ConnectionScope scope(_connectionPool);
+  auto conn = scope.GetConnection();
+  pqxx::work tran(*conn);
+  tran.exec_params(queries::DELETE_EXPIRED_IDEMPOTENCY_KEYS, now);
+  tran.commit();
+}
@@ -3,7 +3,11 @@
 
 #include "./../db/idatabase.h"
 #include "./../common/appsettings.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstring>
+#include <initializer_list>
 #include <memory>
 #include <mutex>
 #include <pqxx/connection>
@@ -21,7 +25,10 @@ using namespace db::models;
 
 class PgDatabase : public IDataBase {
 public:
-  PgDatabase(const std::string_view &connectionString);
+  // empty replica connection string - all reads go to primary
+  PgDatabase(const std::string_view &connectionString,
+             const std::string_view &replicaConnectionString = {},
+             std::chrono::milliseconds maxReplicaLag = std::chrono::seconds(1));
   ~PgDatabase();
 
   CertificateModelPtr GetCertificate(const std::string &serial) override;
@@ -29,22 +36,59 @@ public:
   GetCertificates(const std::string &caSerial) override;
   std::vector<CertificateModelPtr> GetAllCertificates() override;
   CertificateAuthorityModelPtr GetCa(const std::string &serial) override;
-  std::vector<CertificateAuthorityModelPtr> GetAllCa() override;
+  CertificateAuthorityMetadataModelPtr
+  GetCaMetadata(const std::string &serial) override;
+  std::vector<CertificateAuthorityMetadataModelPtr> GetAllCa() override;
   std::vector<std::byte> GetCaCertificateData(const std::string &serial) override;
   void AddCertificate(const CertificateModel &cert) override;
   void AddCA(const CertificateAuthorityModel &ca) override;
 
   void MakeCertificateRevoked(const std::string &serial,
-                              const DateTimePtr revokeDate) override;
+                              const DateTime revokeDate) override;
   std::vector<CertificateModelPtr>
-  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial) override;
-  CertificateModelPtr GetLastRevoked(const std::string &caSerial) override;
+  GetRevokedListOrderByRevokeDateDesc(const std::string &caSerial,
+                                      std::int32_t partition,
+                                      const DateTime &validAt) override;
+  CertificateModelPtr GetLastRevoked(const std::string &caSerial,
+                                     std::int32_t partition) override;
 
   void AddCrl(const CrlModel &crl) override;
-  CrlModelPtr GetActualCrl(const std::string &caSerial) override;
+  CrlModelPtr GetActualCrl(const std::string &caSerial,
+                           std::int32_t partition) override;
+  bool TryWithCrlLock(const std::string &caSerial, std::int32_t partition,
+                      std::chrono::milliseconds wait,
+                      const std::function<void()> &generate) override;
+  bool ClaimIdempotencyKey(const IdempotencyModel &model) override;
+  IdempotencyModelPtr GetIdempotencyKey(const std::string &key) override;
+  void CompleteIdempotencyKey(const IdempotencyModel &model) override;
+  void DeleteIdempotencyKey(const std::string &key) override;
+  void DeleteExpiredIdempotencyKeys(const DateTime &now) override;
 
 private:
+  // reads of the current thread go to primary while alive
+  struct PrimaryReads {
+    PrimaryReads();
+    ~PrimaryReads();
+  };
+
+  // replica when usable, primary on lag, error or empty result
+  PqResult Read(const char *query, const PqParams &params = PqParams());
+  bool UseReplica() const;
+  bool ReplicaInSync(PqConnection &conn);
+  void SkipReplica();
+  void MarkWrite();
+
   ConnectionPoolPtr _connectionPool;
+  // binary result format reads
+  PqConnectionPoolPtr _readPool;
+  // sessions holding CRL locks, kept apart from reads of generate
+  PqConnectionPoolPtr _lockPool;
+  // null when replica is not configured
+  PqConnectionPoolPtr _replicaPool;
+  std::chrono::milliseconds _maxReplicaLag;
+  // steady clock ticks
+  std::atomic<std::int64_t> _replicaSkipUntil{0};
+  std::atomic<std::int64_t> _replicaCheckedAt{0};
 };
 } // namespace postgre
 
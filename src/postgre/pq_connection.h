@@ -0,0 +1,246 @@
+#ifndef _CASERV_POSTGRE_PQ_CONNECTION_H_
+#define _CASERV_POSTGRE_PQ_CONNECTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <libpq-fe.h>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "./../common/datetime.h"
+#include "./../common/hex.h"
+#include "type_spesc/binary_spec.h"
+
+namespace postgre {
+
+/*
+    Query result in binary format. Values are read directly from libpq buffers.
+*/
+class PqResult {
+public:
+  explicit PqResult(PGresult *result) : _result(result, ::PQclear) {}
+
+  ExecStatusType Status() const { return PQresultStatus(_result.get()); }
+  // SQLSTATE of failed query, empty when there is none
+  std::string SqlState() const {
+    auto state = PQresultErrorField(_result.get(), PG_DIAG_SQLSTATE);
+    return state == nullptr ? std::string() : std::string(state);
+  }
+  int Rows() const { return PQntuples(_result.get()); }
+  int Columns() const { return PQnfields(_result.get()); }
+  bool Empty() const { return Rows() == 0; }
+  bool IsNull(int row, int col) const {
+    return PQgetisnull(_result.get(), row, col) == 1;
+  }
+
+  std::size_t Length(int row, int col) const {
+    return static_cast<std::size_t>(PQgetlength(_result.get(), row, col));
+  }
+
+  // total size of all values, used to size arenas for the whole result
+  std::size_t TotalLength() const {
+    std::size_t result = 0;
+    for (int row = 0; row < Rows(); ++row)
+      for (int col = 0; col < Columns(); ++col)
+        result += Length(row, col);
+    return result;
+  }
+
+  // text, varchar: binary representation is the raw string
+  std::string_view GetString(int row, int col) const {
+    return std::string_view(PQgetvalue(_result.get(), row, col),
+                            PQgetlength(_result.get(), row, col));
+  }
+
+  // bytea: binary representation is the raw content
+  std::span<const std::byte> GetBytes(int row, int col) const {
+    auto data =
+        reinterpret_cast<const std::byte *>(PQgetvalue(_result.get(), row, col));
+    return std::span<const std::byte>(data, PQgetlength(_result.get(), row, col));
+  }
+
+  std::int64_t GetInt64(int row, int col) const {
+    return binary::read_int64(PQgetvalue(_result.get(), row, col));
+  }
+
+  std::int32_t GetInt32(int row, int col) const {
+    return binary::read_int32(PQgetvalue(_result.get(), row, col));
+  }
+
+  bool GetBool(int row, int col) const {
+    return *PQgetvalue(_result.get(), row, col) != 0;
+  }
+
+  datetime::DateTime GetDateTime(int row, int col) const {
+    return binary::read_timestamp(PQgetvalue(_result.get(), row, col));
+  }
+
+  datetime::DateTimeOpt GetDateTimeOpt(int row, int col) const {
+    if (IsNull(row, col))
+      return std::nullopt;
+    return GetDateTime(row, col);
+  }
+
+private:
+  std::unique_ptr<PGresult, decltype(&::PQclear)> _result;
+};
+
+/*
+    Query parameters owning their values. Strings are sent as text,
+    timestamps, integers and bytea in binary format.
+*/
+class PqParams {
+public:
+  PqParams &Text(const std::string_view &value) {
+    return Add(std::string(value), 0, 0);
+  }
+
+  PqParams &Int32(std::int32_t value) {
+    std::string data(4, '\0');
+    binary::write_int32(data.data(), value);
+    return Add(std::move(data), INT4OID, 1);
+  }
+
+  PqParams &Timestamp(const datetime::DateTime &value) {
+    std::string data(8, '\0');
+    binary::write_timestamp(data.data(), value);
+    return Add(std::move(data), TIMESTAMPTZOID, 1);
+  }
+
+  PqParams &Timestamp(const datetime::DateTimeOpt &value) {
+    return value.has_value() ? Timestamp(*value) : Null();
+  }
+
+  PqParams &Bytes(std::span<const std::byte> value) {
+    return Add(std::string(reinterpret_cast<const char *>(value.data()),
+                           value.size()),
+               BYTEAOID, 1);
+  }
+
+  // serial or thumbprint text of API stored as bytea, not hex text gives
+  // empty value that matches no row
+  PqParams &Hex(const std::string_view &value) {
+    std::string data(hex::decoded_size(value), '\0');
+    if (!hex::decode(value, reinterpret_cast<std::byte *>(data.data())))
+      data.clear();
+    return Add(std::move(data), BYTEAOID, 1);
+  }
+
+  PqParams &Null() {
+    _values.emplace_back();
+    _types.push_back(0);
+    _formats.push_back(0);
+    _null.push_back(true);
+    return *this;
+  }
+
+  int Size() const { return static_cast<int>(_values.size()); }
+  const Oid *Types() const { return _types.data(); }
+  const int *Formats() const { return _formats.data(); }
+
+  // pointers into owned values, valid until params are modified
+  void Pointers(std::vector<const char *> &values,
+                std::vector<int> &lengths) const {
+    values.clear();
+    lengths.clear();
+    for (std::size_t i = 0; i < _values.size(); ++i) {
+      values.push_back(_null[i] ? nullptr : _values[i].data());
+      lengths.push_back(static_cast<int>(_values[i].size()));
+    }
+  }
+
+private:
+  // pg_type OIDs of binary parameters
+  static constexpr Oid INT4OID = 23;
+  static constexpr Oid BYTEAOID = 17;
+  static constexpr Oid TIMESTAMPTZOID = 1184;
+
+  PqParams &Add(std::string &&value, Oid type, int format) {
+    _values.push_back(std::move(value));
+    _types.push_back(type);
+    _formats.push_back(format);
+    _null.push_back(false);
+    return *this;
+  }
+
+  std::vector<std::string> _values;
+  std::vector<Oid> _types;
+  std::vector<int> _formats;
+  std::vector<bool> _null;
+};
+
+// query error with SQLSTATE of the server, empty for connection errors
+class PqError : public std::runtime_error {
+public:
+  PqError(const char *message, std::string sqlState)
+      : std::runtime_error(message), _sqlState(std::move(sqlState)) {}
+
+  const std::string &SqlState() const { return _sqlState; }
+
+private:
+  std::string _sqlState;
+};
+
+/*
+    Raw libpq connection. pqxx always requests text results, this one is used
+    for read queries that ask server for binary result format.
+*/
+class PqConnection {
+public:
+  explicit PqConnection(const std::string_view &connectionString)
+      : _conn(PQconnectdb(std::string(connectionString).c_str()), ::PQfinish) {
+    if (PQstatus(_conn.get()) != CONNECTION_OK)
+      throw std::runtime_error(PQerrorMessage(_conn.get()));
+  }
+  ~PqConnection() = default;
+
+  /*
+      Execute query with text parameters and binary result format.
+  */
+  PqResult ExecBinary(const char *query,
+                      std::initializer_list<const char *> params = {}) {
+    if (PQstatus(_conn.get()) != CONNECTION_OK)
+      PQreset(_conn.get());
+    auto result = PqResult(PQexecParams(_conn.get(), query,
+                                        static_cast<int>(params.size()),
+                                        nullptr, params.begin(), nullptr,
+                                        nullptr, 1 /* binary */));
+    auto status = result.Status();
+    if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK)
+      throw PqError(PQerrorMessage(_conn.get()), result.SqlState());
+    return result;
+  }
+
+  /*
+      Execute query with typed parameters and binary result format.
+  */
+  PqResult ExecBinary(const char *query, const PqParams &params) {
+    if (PQstatus(_conn.get()) != CONNECTION_OK)
+      PQreset(_conn.get());
+    std::vector<const char *> values;
+    std::vector<int> lengths;
+    params.Pointers(values, lengths);
+    auto result = PqResult(PQexecParams(
+        _conn.get(), query, params.Size(), params.Types(), values.data(),
+        lengths.data(), params.Formats(), 1 /* binary */));
+    auto status = result.Status();
+    if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK)
+      throw PqError(PQerrorMessage(_conn.get()), result.SqlState());
+    return result;
+  }
+
+private:
+  std::unique_ptr<PGconn, decltype(&::PQfinish)> _conn;
+};
+
+using PqConnectionPtr = std::shared_ptr<PqConnection>;
+
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_PQ_CONNECTION_H_
@@ -0,0 +1,99 @@
+#include "pq_listener.h"
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <fcntl.h>
+#include <libpq-fe.h>
+#include <memory>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+#include "pq_connection.h"
+#include "queries.h"
+#include "./../common/logger.h"
+
+using namespace postgre;
+
+static constexpr int MIN_RECONNECT_DELAY_MS = 1000;
+static constexpr int MAX_RECONNECT_DELAY_MS = 30000;
+
+PqListener::PqListener(const std::string_view &connectionString,
+                       NotifyHandler onNotify, ResetHandler onReset)
+    : _connectionString(connectionString), _onNotify(std::move(onNotify)),
+      _onReset(std::move(onReset)) {
+  if (pipe(_wakeup) != 0)
+    throw std::runtime_error("Cannot create listener wakeup pipe.");
+  fcntl(_wakeup[0], F_SETFL, O_NONBLOCK);
+  fcntl(_wakeup[1], F_SETFL, O_NONBLOCK);
+  _thread = std::thread([this] { Run(); });
+}
+
+PqListener::~PqListener() {
+  _stop.store(true);
+  char signal = 1;
+  [[maybe_unused]] auto written = write(_wakeup[1], &signal, 1);
+  _thread.join();
+  close(_wakeup[0]);
+  close(_wakeup[1]);
+}
+
+void PqListener::Run() {
+  auto delay = MIN_RECONNECT_DELAY_MS;
+  while (!_stop.load()) {
+    try {
+      Listen();
+      delay = MIN_RECONNECT_DELAY_MS;
+    } catch (const std::exception &ex) {
+      LOG_ERROR("Invalidation listener error: {}", ex.what());
+    }
+    if (!Wait(delay))
+      return;
+    delay = std::min(delay * 2, MAX_RECONNECT_DELAY_MS);
+  }
+}
+
+bool PqListener::Wait(int timeoutMs) {
+  pollfd fd{_wakeup[0], POLLIN, 0};
+  poll(&fd, 1, timeoutMs);
+  return !_stop.load();
+}
+
+void PqListener::Listen() {
+  std::unique_ptr<PGconn, decltype(&::PQfinish)> conn(
+      PQconnectdb(_connectionString.c_str()), ::PQfinish);
+  if (PQstatus(conn.get()) != CONNECTION_OK)
+    throw std::runtime_error(PQerrorMessage(conn.get()));
+  PqResult listen(PQexec(conn.get(), queries::LISTEN_INVALIDATIONS));
+  if (listen.Status() != PGRES_COMMAND_OK)
+    throw std::runtime_error(PQerrorMessage(conn.get()));
+  _onReset();
+  LOG_INFO("Invalidation listener connected.");
+
+  while (!_stop.load()) {
+    pollfd fds[2] = {{_wakeup[0], POLLIN, 0},
+                     {PQsocket(conn.get()), POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error("Listener poll error.");
+    }
+    if (fds[0].revents != 0)
+      return;
+    if (fds[1].revents == 0)
+      continue;
+    if (PQconsumeInput(conn.get()) != 1)
+      throw std::runtime_error(PQerrorMessage(conn.get()));
+    while (auto notify = PQnotifies(conn.get())) {
+      std::string payload(notify->extra);
+      PQfreemem(notify);
+      try {
+        _onNotify(payload);
+      } catch (const std::exception &ex) {
+        LOG_ERROR("Invalidation {} error: {}", payload, ex.what());
+      }
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef _CASERV_POSTGRE_PQ_LISTENER_H_
+#define _CASERV_POSTGRE_PQ_LISTENER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace postgre {
+
+/*
+    Dedicated connection waiting for NOTIFY on invalidation channel. The
+    connection is reopened with backoff when lost; notifications sent while
+    disconnected are lost, so onReset is called after every (re)connect and
+    receivers drop everything they cached.
+*/
+class PqListener {
+public:
+  using NotifyHandler = std::function<void(const std::string &payload)>;
+  using ResetHandler = std::function<void()>;
+
+  PqListener(const std::string_view &connectionString, NotifyHandler onNotify,
+             ResetHandler onReset);
+  ~PqListener();
+  PqListener(const PqListener &) = delete;
+  PqListener &operator=(const PqListener &) = delete;
+
+private:
+  void Run();
+  void Listen();
+  // false when stopped while waiting
+  bool Wait(int timeoutMs);
+
+  std::string _connectionString;
+  NotifyHandler _onNotify;
+  ResetHandler _onReset;
+  // self-pipe, wakes listener up on stop
+  int _wakeup[2]{-1, -1};
+  std::atomic<bool> _stop{false};
+  std::thread _thread;
+};
+
+using PqListenerPtr = std::shared_ptr<PqListener>;
+
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_PQ_LISTENER_H_
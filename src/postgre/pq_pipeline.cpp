@@ -0,0 +1,230 @@
+#include "pq_pipeline.h"
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "./../common/logger.h"
+
+using namespace postgre;
+
+static void Invoke(const PqPipeline::Callback &callback,
+                   std::unique_ptr<PqResult> result, std::exception_ptr error) {
+  try {
+    callback(std::move(result), error);
+  } catch (const std::exception &ex) {
+    LOG_ERROR("Pipeline callback error: {}", ex.what());
+  } catch (...) {
+    LOG_ERROR("Pipeline callback error.");
+  }
+}
+
+static std::exception_ptr Error(const std::string &message) {
+  return std::make_exception_ptr(std::runtime_error(message));
+}
+
+PqPipeline::PqPipeline(const std::string_view &connectionString,
+                       std::size_t connections)
+    : _connectionString(connectionString), _connections(connections) {
+  if (pipe(_wakeup) != 0)
+    throw std::runtime_error("Cannot create pipeline wakeup pipe.");
+  fcntl(_wakeup[0], F_SETFL, O_NONBLOCK);
+  fcntl(_wakeup[1], F_SETFL, O_NONBLOCK);
+  try {
+    for (auto &connection : _connections)
+      Connect(connection);
+  } catch (...) {
+    close(_wakeup[0]);
+    close(_wakeup[1]);
+    throw;
+  }
+  _thread = std::thread([this] { Run(); });
+}
+
+PqPipeline::~PqPipeline() {
+  _stop.store(true);
+  Wakeup();
+  _thread.join();
+  for (auto &connection : _connections)
+    Fail(connection, "Pipeline stopped.");
+  for (auto &query : _queue)
+    Invoke(query.callback, nullptr, Error("Pipeline stopped."));
+  close(_wakeup[0]);
+  close(_wakeup[1]);
+}
+
+void PqPipeline::Submit(const char *query, PqParams params, Callback callback) {
+  {
+    std::lock_guard<std::mutex> lock(_queueMutex);
+    if (_stop.load())
+      throw std::runtime_error("Pipeline stopped.");
+    _queue.push_back(Query{query, std::move(params), std::move(callback)});
+  }
+  Wakeup();
+}
+
+void PqPipeline::Wakeup() {
+  char signal = 1;
+  // full pipe already guarantees a wakeup
+  [[maybe_unused]] auto written = write(_wakeup[1], &signal, 1);
+}
+
+void PqPipeline::Connect(Connection &connection) {
+  connection.conn.reset(PQconnectdb(_connectionString.c_str()));
+  connection.flushPending = false;
+  auto conn = connection.conn.get();
+  if (PQstatus(conn) != CONNECTION_OK) {
+    std::string message = PQerrorMessage(conn);
+    connection.conn.reset();
+    throw std::runtime_error(message);
+  }
+  if (PQsetnonblocking(conn, 1) != 0 || PQenterPipelineMode(conn) != 1) {
+    std::string message = PQerrorMessage(conn);
+    connection.conn.reset();
+    throw std::runtime_error(message);
+  }
+}
+
+void PqPipeline::Run() {
+  std::vector<pollfd> fds;
+  while (!_stop.load()) {
+    std::deque<Query> queries;
+    {
+      std::lock_guard<std::mutex> lock(_queueMutex);
+      std::swap(queries, _queue);
+    }
+    for (auto &query : queries) {
+      auto connection = std::min_element(
+          _connections.begin(), _connections.end(),
+          [](const Connection &a, const Connection &b) {
+            return a.pending.size() < b.pending.size();
+          });
+      Send(*connection, query);
+    }
+
+    fds.clear();
+    fds.push_back(pollfd{_wakeup[0], POLLIN, 0});
+    for (auto &connection : _connections) {
+      // negative fd is ignored by poll, disconnected until next Send
+      auto fd = connection.conn ? PQsocket(connection.conn.get()) : -1;
+      short events = POLLIN | (connection.flushPending ? POLLOUT : 0);
+      fds.push_back(pollfd{fd, events, 0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      LOG_ERROR("Pipeline poll error: {}", errno);
+      continue;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      char buffer[64];
+      while (read(_wakeup[0], buffer, sizeof(buffer)) > 0) {
+      }
+    }
+    for (std::size_t i = 0; i < _connections.size(); ++i) {
+      auto &connection = _connections[i];
+      auto revents = fds[i + 1].revents;
+      if (!connection.conn || revents == 0)
+        continue;
+      if (revents & POLLOUT) {
+        auto flushed = PQflush(connection.conn.get());
+        connection.flushPending = flushed == 1;
+        if (flushed < 0) {
+          Fail(connection, PQerrorMessage(connection.conn.get()));
+          continue;
+        }
+      }
+      if (revents & (POLLIN | POLLERR | POLLHUP))
+        Receive(connection);
+    }
+  }
+}
+
+void PqPipeline::Send(Connection &connection, Query &query) {
+  if (!connection.conn || PQstatus(connection.conn.get()) != CONNECTION_OK) {
+    try {
+      Connect(connection);
+    } catch (const std::exception &) {
+      Invoke(query.callback, nullptr, std::current_exception());
+      return;
+    }
+  }
+
+  auto conn = connection.conn.get();
+  std::vector<const char *> values;
+  std::vector<int> lengths;
+  query.params.Pointers(values, lengths);
+  if (PQsendQueryParams(conn, query.sql, query.params.Size(),
+                        query.params.Types(), values.data(), lengths.data(),
+                        query.params.Formats(), 1 /* binary */) != 1) {
+    Invoke(query.callback, nullptr, Error(PQerrorMessage(conn)));
+    return;
+  }
+  connection.pending.push_back(Pending{std::move(query.callback)});
+  if (PQpipelineSync(conn) != 1) {
+    Fail(connection, PQerrorMessage(conn));
+    return;
+  }
+  auto flushed = PQflush(conn);
+  connection.flushPending = flushed == 1;
+  if (flushed < 0)
+    Fail(connection, PQerrorMessage(conn));
+}
+
+void PqPipeline::Receive(Connection &connection) {
+  auto conn = connection.conn.get();
+  if (PQconsumeInput(conn) != 1) {
+    Fail(connection, PQerrorMessage(conn));
+    return;
+  }
+  while (!connection.pending.empty() && PQisBusy(conn) == 0) {
+    auto result = PQgetResult(conn);
+    // end of one query results, its sync follows
+    if (result == nullptr)
+      continue;
+    auto status = PQresultStatus(result);
+    if (status == PGRES_PIPELINE_SYNC) {
+      PQclear(result);
+      auto pending = std::move(connection.pending.front());
+      connection.pending.pop_front();
+      if (!pending.delivered)
+        Invoke(pending.callback, nullptr, Error("Query returned no result."));
+      continue;
+    }
+    auto &pending = connection.pending.front();
+    if (pending.delivered) {
+      PQclear(result);
+      continue;
+    }
+    pending.delivered = true;
+    if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
+      Invoke(pending.callback, std::make_unique<PqResult>(result), nullptr);
+    } else {
+      std::string message = PQresultErrorMessage(result);
+      PQclear(result);
+      Invoke(pending.callback, nullptr, Error(message));
+    }
+  }
+}
+
+void PqPipeline::Fail(Connection &connection, const std::string &message) {
+  if (!connection.pending.empty())
+    LOG_ERROR("Pipeline connection failed: {}", message);
+  for (auto &pending : connection.pending) {
+    if (!pending.delivered)
+      Invoke(pending.callback, nullptr, Error(message));
+  }
+  connection.pending.clear();
+  connection.flushPending = false;
+  // reconnected on next Send
+  connection.conn.reset();
+}
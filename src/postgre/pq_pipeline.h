@@ -0,0 +1,88 @@
+#ifndef _CASERV_POSTGRE_PQ_PIPELINE_H_
+#define _CASERV_POSTGRE_PQ_PIPELINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <libpq-fe.h>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "./../common/datetime.h"
+#include "pq_connection.h"
+
+#ifndef LIBPQ_HAS_PIPELINING
+#error "PqPipeline requires libpq 14 or newer (pipeline mode)"
+#endif
+
+namespace postgre {
+
+/*
+    Fixed set of non-blocking connections in libpq pipeline mode driven by
+    one event loop thread. Queries are queued from any thread and sent to
+    the connection with the fewest queries in flight; every query is
+    followed by its own sync point, so an error fails that query only.
+    Callbacks run on the loop thread and must not block.
+*/
+class PqPipeline {
+public:
+  // result is null when error is set
+  using Callback = std::function<void(std::unique_ptr<PqResult>, std::exception_ptr)>;
+
+  PqPipeline(const std::string_view &connectionString, std::size_t connections);
+  ~PqPipeline();
+  PqPipeline(const PqPipeline &) = delete;
+  PqPipeline &operator=(const PqPipeline &) = delete;
+
+  // binary result format
+  void Submit(const char *query, PqParams params, Callback callback);
+
+private:
+  struct Query {
+    const char *sql;
+    PqParams params;
+    Callback callback;
+  };
+
+  struct Pending {
+    Callback callback;
+    bool delivered{false};
+  };
+
+  struct Connection {
+    std::unique_ptr<PGconn, decltype(&::PQfinish)> conn{nullptr, ::PQfinish};
+    // sent queries in order, completed on their sync result
+    std::deque<Pending> pending;
+    bool flushPending{false};
+  };
+
+  void Run();
+  void Connect(Connection &connection);
+  void Send(Connection &connection, Query &query);
+  void Receive(Connection &connection);
+  void Fail(Connection &connection, const std::string &message);
+  void Wakeup();
+
+  std::string _connectionString;
+  std::vector<Connection> _connections;
+  std::deque<Query> _queue;
+  std::mutex _queueMutex;
+  // self-pipe, wakes loop up on new queries and on stop
+  int _wakeup[2]{-1, -1};
+  std::atomic<bool> _stop{false};
+  std::thread _thread;
+};
+
+using PqPipelinePtr = std::shared_ptr<PqPipeline>;
+
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_PQ_PIPELINE_H_
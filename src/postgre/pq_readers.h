@@ -0,0 +1,137 @@
+#ifndef _CASERV_POSTGRE_PQ_READERS_H_
+#define _CASERV_POSTGRE_PQ_READERS_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "./../common/arena.h"
+#include "./../common/hex.h"
+#include "./../db/models/models.h"
+#include "pq_connection.h"
+
+namespace postgre {
+
+using namespace db::models;
+
+// bytea serial or thumbprint as upper case hex of API and models
+inline std::string_view ReadHex(common::Arena &arena, const PqResult &rows,
+                                int row, int col) {
+  auto bytes = rows.GetBytes(row, col);
+  if (bytes.empty())
+    return std::string_view();
+  auto data = static_cast<char *>(
+      arena.Resource()->allocate(bytes.size() * 2, alignof(char)));
+  hex::encode(bytes, data);
+  return std::string_view(data, bytes.size() * 2);
+}
+
+inline std::string ReadHex(const PqResult &rows, int row, int col) {
+  return hex::encode(rows.GetBytes(row, col));
+}
+
+// "serial", "thumbprint", "caSerial", "commonName", "issueDate", "revokeDate",
+// "expireDate", "crlPartition"
+inline std::shared_ptr<RowSet<CertificateModel>>
+ReadCertificates(const PqResult &rows) {
+  // bytea serials double in size as hex
+  auto set = std::make_shared<RowSet<CertificateModel>>(
+      rows.Rows(), 2 * rows.TotalLength());
+  auto &arena = set->arena;
+  for (int i = 0; i < rows.Rows(); ++i) {
+    set->rows.push_back(CertificateModel{
+        .serial = ReadHex(arena, rows, i, 0),
+        .thumbprint = ReadHex(arena, rows, i, 1),
+        .caSerial = ReadHex(arena, rows, i, 2),
+        .commonName = arena.Store(rows.GetString(i, 3)),
+        .issueDate = rows.GetDateTime(i, 4),
+        .expireDate = rows.GetDateTimeOpt(i, 6),
+        .revokeDate = rows.GetDateTimeOpt(i, 5),
+        .crlPartition = rows.GetInt32(i, 7),
+        .serialBytes = {}});
+  }
+  return set;
+}
+
+// "serial", "revokeDate" - CRL entries, serial is kept as bytes only
+inline std::shared_ptr<RowSet<CertificateModel>>
+ReadRevoked(const PqResult &rows) {
+  auto set =
+      std::make_shared<RowSet<CertificateModel>>(rows.Rows(), rows.TotalLength());
+  auto &arena = set->arena;
+  for (int i = 0; i < rows.Rows(); ++i) {
+    auto &row = set->rows.emplace_back();
+    row.revokeDate = rows.GetDateTimeOpt(i, 1);
+    row.serialBytes = arena.Store(rows.GetBytes(i, 0));
+  }
+  return set;
+}
+
+// bytea in binary format is the raw content, copy it straight into the model
+inline std::vector<std::byte> ReadBytes(const PqResult &rows, int row, int col) {
+  auto bytes = rows.GetBytes(row, col);
+  return std::vector<std::byte>(bytes.begin(), bytes.end());
+}
+
+// "serial", "thumbprint", "commonName", "issueDate", "certificate",
+// "privateKey", "publicUrl"
+inline CertificateAuthorityModelPtr ReadCa(const PqResult &rows, int row) {
+  auto model = std::make_shared<CertificateAuthorityModel>();
+  model->serial = ReadHex(rows, row, 0);
+  model->thumbprint = ReadHex(rows, row, 1);
+  model->commonName = rows.GetString(row, 2);
+  model->issueDate = rows.GetDateTime(row, 3);
+  model->certificate = ReadBytes(rows, row, 4);
+  model->privateKey = ReadBytes(rows, row, 5);
+  model->publicUrl = rows.GetString(row, 6);
+  return model;
+}
+
+// "serial", "thumbprint", "commonName", "issueDate", "publicUrl"
+inline std::shared_ptr<RowSet<CertificateAuthorityMetadataModel>>
+ReadCaMetadata(const PqResult &rows) {
+  auto set = std::make_shared<RowSet<CertificateAuthorityMetadataModel>>(
+      rows.Rows(), 2 * rows.TotalLength());
+  auto &arena = set->arena;
+  for (int i = 0; i < rows.Rows(); ++i) {
+    set->rows.push_back(CertificateAuthorityMetadataModel{
+        .serial = ReadHex(arena, rows, i, 0),
+        .thumbprint = ReadHex(arena, rows, i, 1),
+        .commonName = arena.Store(rows.GetString(i, 2)),
+        .issueDate = rows.GetDateTime(i, 3),
+        .publicUrl = arena.Store(rows.GetString(i, 4))});
+  }
+  return set;
+}
+
+// "caSerial", "partition", "number", "issueDate", "expireDate", "lastSerial",
+// "content"
+inline CrlModelPtr ReadCrl(const PqResult &rows, int row) {
+  auto model = std::make_shared<CrlModel>();
+  model->caSerial = ReadHex(rows, row, 0);
+  model->partition = rows.GetInt32(row, 1);
+  model->number = rows.GetInt32(row, 2);
+  model->issueDate = rows.GetDateTime(row, 3);
+  model->expireDate = rows.GetDateTime(row, 4);
+  model->lastSerial = ReadHex(rows, row, 5);
+  model->content = ReadBytes(rows, row, 6);
+  return model;
+}
+
+// "key", "fingerprint", "expireDate", "serial",
+// pending key has null serial
+inline IdempotencyModelPtr ReadIdempotency(const PqResult &rows, int row) {
+  auto model = std::make_shared<IdempotencyModel>();
+  model->key = rows.GetString(row, 0);
+  model->fingerprint = rows.GetString(row, 1);
+  model->expireDate = rows.GetDateTime(row, 2);
+  if (!rows.IsNull(row, 3))
+    model->serial = ReadHex(rows, row, 3);
+  return model;
+}
+
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_PQ_READERS_H_
@@ -0,0 +1,178 @@
+#ifndef _CASERV_POSTGRE_QUERIES_H_
+#define _CASERV_POSTGRE_QUERIES_H_
+
+/*
+    SQL shared by PgDatabase and AsyncPgDatabase. Column order of SELECT
+    queries matches readers in pq_readers.h. Serials and thumbprints are
+    bytea, parameters are sent as binary (PqParams::Hex), so lookups use
+    plain btree indexes.
+*/
+namespace postgre {
+namespace queries {
+
+// channel of db::Invalidation payloads
+#define INVALIDATION_CHANNEL "caserv_invalidate"
+inline constexpr const char *LISTEN_INVALIDATIONS = "LISTEN " INVALIDATION_CHANNEL;
+
+#define CERTIFICATE_COLUMNS                                                    \
+  "SELECT \"serial\", \"thumbprint\", \"caSerial\", "                          \
+  "\"commonName\", \"issueDate\", \"revokeDate\", \"expireDate\", "          \
+  "\"crlPartition\" "
+
+inline constexpr const char *GET_CERTIFICATE =
+    CERTIFICATE_COLUMNS "FROM certificates "
+                        "WHERE \"serial\" = $1";
+
+inline constexpr const char *GET_CERTIFICATES =
+    CERTIFICATE_COLUMNS "FROM certificates "
+                        "WHERE \"caSerial\" = $1";
+
+inline constexpr const char *GET_ALL_CERTIFICATES =
+    CERTIFICATE_COLUMNS "FROM certificates";
+
+// certificates expired before $3 are left out of CRL, partition $2 of 0 is
+// the full CRL, uses certificates_revoked_idx and
+// certificates_revoked_partition_idx; only columns of CRL entries
+inline constexpr const char *GET_REVOKED =
+    "SELECT \"serial\", \"revokeDate\" "
+    "FROM certificates "
+    "WHERE \"revokeDate\" IS NOT NULL AND \"caSerial\" = $1 "
+    "AND ($2 = 0 OR \"crlPartition\" = $2) "
+    "AND (\"expireDate\" IS NULL OR \"expireDate\" >= $3) "
+    "ORDER BY \"revokeDate\" DESC";
+
+inline constexpr const char *GET_LAST_REVOKED =
+    CERTIFICATE_COLUMNS
+    "FROM certificates "
+    "WHERE \"revokeDate\" IS NOT NULL AND \"caSerial\" = $1 "
+    "AND ($2 = 0 OR \"crlPartition\" = $2) "
+    "ORDER BY \"revokeDate\" DESC LIMIT 1";
+
+#undef CERTIFICATE_COLUMNS
+
+inline constexpr const char *GET_CA =
+    "SELECT \"serial\", \"thumbprint\", \"commonName\", "
+    "\"issueDate\", \"certificate\", \"privateKey\", \"publicUrl\" "
+    "FROM ca "
+    "WHERE \"serial\" = $1";
+
+inline constexpr const char *GET_CA_METADATA =
+    "SELECT \"serial\", \"thumbprint\", \"commonName\", "
+    "\"issueDate\", \"publicUrl\" "
+    "FROM ca "
+    "WHERE \"serial\" = $1";
+
+inline constexpr const char *GET_ALL_CA =
+    "SELECT \"serial\", \"thumbprint\", \"commonName\", "
+    "\"issueDate\", \"publicUrl\" "
+    "FROM ca";
+
+inline constexpr const char *GET_CA_CERTIFICATE_DATA =
+    "SELECT \"certificate\" "
+    "FROM ca "
+    "WHERE \"serial\" = $1";
+
+inline constexpr const char *ADD_CERTIFICATE =
+    "INSERT INTO certificates(\"serial\", \"thumbprint\", \"caSerial\", "
+    "\"commonName\", \"issueDate\", \"revokeDate\", \"expireDate\", "
+    "\"crlPartition\") "
+    "VALUES ($1, $2, $3, $4, $5, $6, $7, $8)";
+
+// writes of shared data notify other instances, the notification is
+// delivered on commit of the same statement; payload serials are upper case
+// hex as in the API
+#define HEX(column) "UPPER(encode(" column ", 'hex'))"
+inline constexpr const char *ADD_CA =
+    "WITH inserted AS ("
+    "INSERT INTO ca(\"serial\", \"thumbprint\", \"commonName\", "
+    "\"issueDate\", \"certificate\", \"privateKey\", \"publicUrl\" ) "
+    "VALUES ($1, $2, $3, $4, $5, $6, $7) RETURNING \"serial\") "
+    "SELECT pg_notify('" INVALIDATION_CHANNEL "', 'ca:' || " HEX("\"serial\"") ") "
+    "FROM inserted";
+
+inline constexpr const char *MAKE_CERTIFICATE_REVOKED =
+    "WITH updated AS ("
+    "UPDATE certificates SET \"revokeDate\" = $1 "
+    "WHERE \"serial\" = $2 "
+    "RETURNING \"serial\", \"caSerial\", \"crlPartition\") "
+    "SELECT pg_notify('" INVALIDATION_CHANNEL "', "
+    "'revoked:' || " HEX("\"serial\"") " || ':' || " HEX("\"caSerial\"")
+    " || ':' || \"crlPartition\") "
+    "FROM updated";
+
+inline constexpr const char *ADD_CRL =
+    "WITH inserted AS ("
+    "INSERT INTO crl(\"caSerial\", \"partition\", \"number\", "
+    "\"issueDate\", \"expireDate\", \"lastSerial\", \"content\") "
+    "VALUES ($1, $2, $3, $4, $5, $6, $7) RETURNING \"caSerial\", \"partition\") "
+    "SELECT pg_notify('" INVALIDATION_CHANNEL "', "
+    "'crl:' || " HEX("\"caSerial\"") " || ':' || \"partition\") "
+    "FROM inserted";
+
+inline constexpr const char *GET_ACTUAL_CRL =
+    "SELECT \"caSerial\", \"partition\", \"number\", \"issueDate\", "
+    "\"expireDate\", \"lastSerial\", \"content\" "
+    "FROM crl "
+    "WHERE \"caSerial\" = $1 AND \"partition\" = $2 "
+    "ORDER BY number DESC LIMIT 1";
+
+// replay delay of a standby in ms, 0 when it replayed all received WAL or
+// is not a standby
+inline constexpr const char *REPLICA_LAG_MS =
+    "SELECT COALESCE(CASE WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() "
+    "THEN 0 ELSE (EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) "
+    "* 1000)::bigint END, 0)";
+
+// expired row is taken over, pending row of a crashed instance expires
+// with its short claim period
+inline constexpr const char *CLAIM_IDEMPOTENCY_KEY =
+    "INSERT INTO idempotency(\"key\", \"fingerprint\", \"expireDate\") "
+    "VALUES ($1, $2, $3) "
+    "ON CONFLICT (\"key\") DO UPDATE SET "
+    "\"fingerprint\" = EXCLUDED.\"fingerprint\", "
+    "\"expireDate\" = EXCLUDED.\"expireDate\", "
+    "\"serial\" = NULL "
+    "WHERE idempotency.\"expireDate\" < now() "
+    "RETURNING \"key\"";
+
+inline constexpr const char *GET_IDEMPOTENCY_KEY =
+    "SELECT \"key\", \"fingerprint\", \"expireDate\", \"serial\" "
+    "FROM idempotency "
+    "WHERE \"key\" = $1 AND \"expireDate\" >= now()";
+
+inline constexpr const char *COMPLETE_IDEMPOTENCY_KEY =
+    "UPDATE idempotency SET \"expireDate\" = $2, \"serial\" = $3 "
+    "WHERE \"key\" = $1";
+
+inline constexpr const char *DELETE_IDEMPOTENCY_KEY =
+    "DELETE FROM idempotency WHERE \"key\" = $1";
+
+inline constexpr const char *DELETE_EXPIRED_IDEMPOTENCY_KEYS =
+    "DELETE FROM idempotency WHERE \"expireDate\" < $1";
+
+// session level lock of CRL generation for CA partition, see with_crl_lock
+#define CRL_LOCK_KEY                                                           \
+  "hashtextextended('caserv.crl:' || UPPER($1) || ':' || $2, 0)"
+
+inline constexpr const char *TRY_LOCK_CRL =
+    "SELECT pg_try_advisory_lock(" CRL_LOCK_KEY ")";
+
+// waits up to lock_timeout, then fails with lock_not_available
+inline constexpr const char *LOCK_CRL =
+    "SELECT pg_advisory_lock(" CRL_LOCK_KEY ")";
+
+// $1 - milliseconds, for the rest of the session
+inline constexpr const char *SET_LOCK_TIMEOUT =
+    "SELECT set_config('lock_timeout', $1, false)";
+
+inline constexpr const char *UNLOCK_CRL =
+    "SELECT pg_advisory_unlock(" CRL_LOCK_KEY ")";
+
+#undef CRL_LOCK_KEY
+#undef HEX
+#undef INVALIDATION_CHANNEL
+
+} // namespace queries
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_QUERIES_H_
@@ -0,0 +1,66 @@
+#ifndef _CASERV_POSTGRE_TYPE_BINARY_H_
+#define _CASERV_POSTGRE_TYPE_BINARY_H_
+
+#include <cstdint>
+#include <ctime>
+
+#include "./../../common/datetime.h"
+
+namespace postgre {
+namespace binary {
+
+// 2000-01-01 00:00:00 UTC, PostgreSQL timestamp epoch
+constexpr std::int64_t PG_EPOCH_UNIX = 946684800;
+
+/*
+    Network byte order readers for binary result format.
+*/
+inline std::int64_t read_int64(const char *data) {
+  auto p = reinterpret_cast<const unsigned char *>(data);
+  std::uint64_t result = 0;
+  for (int i = 0; i < 8; ++i)
+    result = (result << 8) | p[i];
+  return static_cast<std::int64_t>(result);
+}
+
+inline std::int32_t read_int32(const char *data) {
+  auto p = reinterpret_cast<const unsigned char *>(data);
+  return static_cast<std::int32_t>((std::uint32_t(p[0]) << 24) |
+                                   (std::uint32_t(p[1]) << 16) |
+                                   (std::uint32_t(p[2]) << 8) | p[3]);
+}
+
+/*
+    timestamp/timestamptz binary value: int64 microseconds since PG_EPOCH_UNIX.
+*/
+inline datetime::DateTime read_timestamp(const char *data) {
+  auto micros = read_int64(data);
+  // floor division, values before 2000 are negative
+  auto seconds = micros / 1000000 - (micros % 1000000 < 0 ? 1 : 0);
+  return datetime::DateTime{static_cast<std::time_t>(seconds + PG_EPOCH_UNIX)};
+}
+
+/*
+    Network byte order writers for binary parameters.
+*/
+inline void write_int64(char *data, std::int64_t value) {
+  auto v = static_cast<std::uint64_t>(value);
+  for (int i = 7; i >= 0; --i, v >>= 8)
+    data[i] = static_cast<char>(v & 0xFF);
+}
+
+inline void write_int32(char *data, std::int32_t value) {
+  auto v = static_cast<std::uint32_t>(value);
+  for (int i = 3; i >= 0; --i, v >>= 8)
+    data[i] = static_cast<char>(v & 0xFF);
+}
+
+inline void write_timestamp(char *data, const datetime::DateTime &value) {
+  write_int64(data,
+              (static_cast<std::int64_t>(value.value) - PG_EPOCH_UNIX) * 1000000);
+}
+
+} // namespace binary
+} // namespace postgre
+
+#endif //_CASERV_POSTGRE_TYPE_BINARY_H_
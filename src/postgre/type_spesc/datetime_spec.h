@@ -5,43 +5,40 @@
 #include "./../../common/datetime.h"
 
 namespace pqxx {
-template <> std::string const type_name<datetime::DateTimePtr>{"DateTimePtr"};
-template <> struct nullness<datetime::DateTimePtr> {
-  static constexpr bool has_null{true};
-  static constexpr bool always_null{false};
+template <> std::string const type_name<datetime::DateTime>{"DateTime"};
+template <> struct nullness<datetime::DateTime> : no_null<datetime::DateTime> {};
 
-  static bool is_null(datetime::DateTimePtr const &value) {
-    return value == nullptr;
-  }
-
-  [[nodiscard]] static datetime::DateTimePtr null() { return nullptr; }
-};
-
-template <> struct string_traits<datetime::DateTimePtr> {
+template <> struct string_traits<datetime::DateTime> {
   static constexpr bool converts_to_string{true};
   static constexpr bool converts_from_string{true};
 
-  static zview to_buf(char *begin, char *end, datetime::DateTimePtr const &value) {
-    return datetime::to_utcstring(value);
+  static zview to_buf(char *begin, char *end, datetime::DateTime const &value) {
+    auto stop = into_buf(begin, end, value);
+    return zview(begin, stop - begin - 1);
+  }
+
+  static char *into_buf(char *begin, char *end, datetime::DateTime const &value) {
+    if (end - begin < static_cast<std::ptrdiff_t>(size_buffer(value)))
+      throw conversion_overrun("Not enough buffer space for DateTime.");
+    auto stop = datetime::format_utc(begin, value);
+    *stop++ = '\0';
+    return stop;
   }
 
-  static char *into_buf(char *begin, char *end, datetime::DateTimePtr const &value) {
-    if(value == nullptr) return nullptr;
-    auto dt = datetime::to_utcstring(value);
-    auto a= memccpy(begin, dt.c_str(), '\0', dt.length());
-    auto b = begin + dt.length();
-    return begin + dt.length();
+  // 2012-08-24 14:00:00 UTC
+  static std::size_t size_buffer(datetime::DateTime const &) noexcept {
+    return datetime::UTC_STRING_SIZE + 1;
   }
-  
-  //2012-08-24 14:00:00+03:00
-  static std::size_t size_buffer(datetime::DateTimePtr const &value) noexcept { return 33; }
 
-  static datetime::DateTimePtr from_string(std::string_view text) {
-    if(text.empty()) return nullptr;
-    return datetime::from_utcstring(text.data());
+  // 2012-08-24 14:00:00+03 (server output)
+  static datetime::DateTime from_string(std::string_view text) {
+    datetime::DateTime result;
+    if (!datetime::try_parse(text, result))
+      throw conversion_error("Invalid timestamp: " + std::string(text));
+    return result;
   }
 };
 } // namespace pqxx
 
 
-#endif //_CASERV_POSTGRE_TYPE_DATETIME_H_
\ No newline at end of file
+#endif //_CASERV_POSTGRE_TYPE_DATETIME_H_
@@ -1,5 +1,10 @@
 #include "caservice.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <ctime>
 #include <fmt/format.h>
 #include <memory>
@@ -10,16 +15,39 @@
 #include <utility>
 #include <vector>
 
+#include "./../common/arena.h"
 #include "./../common/datetime.h"
 #include "./../common/logger.h"
+#include "./../common/metrics.h"
+#include "./../common/tracing.h"
 #include "models/models.h"
 
 using namespace serivce;
 
+// per request temporaries (subject, extension values) fit this buffer
+static constexpr std::size_t ISSUE_ARENA_SIZE = 4096;
+
+// wait for CRL lock held by another generation, without a previous CRL to
+// return the request has nothing else to do
+static constexpr auto CRL_LOCK_WAIT = std::chrono::seconds(1);
+static constexpr auto FIRST_CRL_LOCK_WAIT = std::chrono::seconds(10);
+
+static void LogArenaStats(const common::Arena &arena) {
+  auto stats = arena.Stats();
+  LOG_DEBUG("Issue arena: {} allocations, {} bytes, {} upstream allocations, "
+            "{} upstream bytes.",
+            stats.allocations, stats.bytes, stats.upstreamAllocations,
+            stats.upstreamBytes);
+}
+
 const PhysicalPersonCertificateRequest &
-Map(PhysicalPersonCertificateRequest &dst, const IssueCertificateModel &src) {
+Map(PhysicalPersonCertificateRequest &dst, const IssueCertificateModel &src,
+    common::Arena &arena) {
   dst.algorithm = src.algorithm;
-  src.surname.empty() ? dst.commonName = fmt::format("{} {}", src.surname, src.givenName) : dst.commonName = src.givenName;
+  dst.commonName =
+      src.surname.empty()
+          ? std::string_view(src.givenName)
+          : arena.Store(fmt::format("{} {}", src.surname, src.givenName));
   dst.country = src.country;
   dst.localityName = src.localityName;
   dst.stateOrProvinceName = src.stateOrProvinceName;
@@ -31,21 +59,23 @@ Map(PhysicalPersonCertificateRequest &dst, const IssueCertificateModel &src) {
   dst.givenName = src.givenName;
   dst.surname = src.surname;
   dst.pin = src.pin;
+  dst.profile = src.profile;
   return dst;
 }
 
 const IndividualEntrepreneurCertificateRequest &
 Map(IndividualEntrepreneurCertificateRequest &dst,
-    const IssueCertificateModel &src) {
-  Map(static_cast<PhysicalPersonCertificateRequest &>(dst), src);
+    const IssueCertificateModel &src, common::Arena &arena) {
+  Map(static_cast<PhysicalPersonCertificateRequest &>(dst), src, arena);
   dst.commonName = src.organizationName;
   dst.ogrnip = src.ogrnip;
   return dst;
 }
 
 const JuridicalPersonCertificateRequest &
-Map(JuridicalPersonCertificateRequest &dst, const IssueCertificateModel &src) {
-  Map(static_cast<PhysicalPersonCertificateRequest &>(dst), src);
+Map(JuridicalPersonCertificateRequest &dst, const IssueCertificateModel &src,
+    common::Arena &arena) {
+  Map(static_cast<PhysicalPersonCertificateRequest &>(dst), src, arena);
   dst.innLe = src.innLe;
   dst.ogrn = src.ogrn;
   dst.organizationName = src.organizationName;
@@ -55,67 +85,64 @@ Map(JuridicalPersonCertificateRequest &dst, const IssueCertificateModel &src) {
   return dst;
 }
 
-CaService::CaService(IDataBasePtr db, ICryptoProviderUPtr crypto) : _db(db) {
+/*
+    Maps model to the request of its subject type and runs issue with it,
+    commonName receives the subject name of the mapped request.
+*/
+template <typename TIssue>
+static auto IssueBySubjectType(const IssueCertificateModel &model,
+                               std::int32_t crlPartition, common::Arena &arena,
+                               std::string_view &commonName, TIssue issue) {
+  auto run = [&](auto req) {
+    req.crlPartition = crlPartition;
+    auto result = issue(Map(req, model, arena));
+    commonName = req.commonName;
+    return result;
+  };
+  if (model.subjectType == SujectTypeEnum::PhysicalPerson)
+    return run(PhysicalPersonCertificateRequest{});
+  if (model.subjectType == SujectTypeEnum::IndividualEntrepreneur)
+    return run(IndividualEntrepreneurCertificateRequest{});
+  if (model.subjectType == SujectTypeEnum::JuridicalPerson)
+    return run(JuridicalPersonCertificateRequest{});
+  LOG_ERROR("SubjectTypeEnum value: {} not supported.", (int)model.subjectType);
+  throw std::runtime_error("Invalid SubjectTypeEnum value");
+}
+
+CaService::CaService(IDataBasePtr db, ICryptoProviderUPtr crypto,
+                     std::int32_t crlPartitions)
+    : _db(db), _crlPartitions(crlPartitions) {
+  if (_crlPartitions < 0)
+    throw std::invalid_argument("CRL partition count must not be negative.");
   _crypto = std::move(crypto);
 }
 
+std::int32_t CaService::NextCrlPartition() {
+  if (_crlPartitions == 0)
+    return 0;
+  // CDP is signed into the certificate before its serial is known, so the
+  // partition cannot be derived from the serial
+  auto next = _nextCrlPartition.fetch_add(1, std::memory_order_relaxed);
+  return static_cast<std::int32_t>(next % _crlPartitions) + 1;
+}
+
 CaService::~CaService() {}
 
 StoredCertificateModelPtr CaService::GetCertificate(const std::string &serial) {
-  auto model = _db->GetCertificate(serial);
-  if (model != nullptr) {
-    auto result = std::make_shared<StoredCertificateModel>();
-    result->caSerial = model->caSerial;
-    result->serial = model->serial;
-    result->thumbprint = model->thumbprint;
-    result->commonName = model->commonName;
-    result->issueDate = model->issueDate;
-    result->revokeDate = model->revokeDate;
-    return result;
-  }
-  return nullptr;
+  return _db->GetCertificate(serial);
 }
+
 std::vector<StoredCertificateModelPtr>
 CaService::GetCertificates(const std::string &caSerial) {
-  auto result = std::vector<StoredCertificateModelPtr>();
-  auto models = _db->GetCertificates(caSerial);
-  for (auto m : models) {
-    auto cert = std::make_shared<StoredCertificateModel>();
-    cert->caSerial = m->caSerial;
-    cert->serial = m->serial;
-    cert->thumbprint = m->thumbprint;
-    cert->commonName = m->commonName;
-    cert->issueDate = m->issueDate;
-    cert->revokeDate = m->revokeDate;
-    result.push_back(cert);
-  }
-  return result;
+  return _db->GetCertificates(caSerial);
 }
+
 std::vector<StoredCertificateModelPtr> CaService::GetAllCertificates() {
-  auto result = std::vector<StoredCertificateModelPtr>();
-  auto models = _db->GetAllCertificates();
-  for (auto m : models) {
-    auto cert = std::make_shared<StoredCertificateModel>();
-    cert->caSerial = m->caSerial;
-    cert->serial = m->serial;
-    cert->thumbprint = m->thumbprint;
-    cert->commonName = m->commonName;
-    cert->issueDate = m->issueDate;
-    cert->revokeDate = m->revokeDate;
-    result.push_back(cert);
-  }
-  return result;
+  return _db->GetAllCertificates();
 }
 
 StoredCertificateAuthorityModelPtr CaService::GetCa(const std::string &serial) {
-  auto model = _db->GetCa(serial);
-  auto result = std::make_shared<StoredCertificateAuthorityModel>();
-  result->serial = std::string_view(model->serial.data());
-  result->thumbprint = std::string_view(model->thumbprint.data());
-  result->commonName = std::string_view(model->commonName.data());
-  result->issueDate = model->issueDate;
-  result->publicUrl = std::string_view(model->publicUrl);
-  return result;
+  return _db->GetCaMetadata(serial);
 }
 
 std::vector<std::byte>
@@ -124,22 +151,12 @@ CaService::GetCaCertificateData(const std::string &serial) {
 }
 
 std::vector<StoredCertificateAuthorityModelPtr> CaService::GetAllCa() {
-  std::vector<StoredCertificateAuthorityModelPtr> result;
-  auto models = _db->GetAllCa();
-  for (auto model : models) {
-    auto entry = std::make_shared<StoredCertificateAuthorityModel>();
-    entry->serial = model->serial;
-    entry->thumbprint = model->thumbprint;
-    entry->commonName = model->commonName;
-    entry->issueDate = model->issueDate;
-    entry->publicUrl = model->publicUrl;
-    result.push_back(entry);
-  }
-  return result;
+  return _db->GetAllCa();
 }
 
 StoredCertificateAuthorityModelPtr
 CaService::CreateCA(const CreateCertificateAuthorityModel &model) {
+  tracing::ScopedSpan span("CaService.CreateCA");
   JuridicalPersonCertificateRequest req;
   req.commonName = model.organizationName;
   req.country = model.country;
@@ -152,16 +169,16 @@ CaService::CreateCA(const CreateCertificateAuthorityModel &model) {
   req.organizationName = model.organizationName;
   req.algorithm = model.algorithm;
   req.ttlInDays = model.ttlInDays;
+  req.profile = model.profile;
 
   auto caCert = _crypto->GeneratedCACertificate(req);
   CertificateAuthorityModel data{.serial = caCert->serialNumber,
                                  .thumbprint = caCert->thumbprint,
                                  .commonName = model.organizationName,
+                                 .issueDate = datetime::utc_now(),
                                  .certificate = caCert->certificate,
                                  .privateKey = caCert->privateKey,
                                  .publicUrl = model.publicUrl};
-  auto dt = datetime::utc_now();
-  data.issueDate = dt;
 
   _db->AddCA(data);
   return GetCa(caCert->serialNumber);
@@ -170,148 +187,244 @@ CaService::CreateCA(const CreateCertificateAuthorityModel &model) {
 PKCS12ContainerUPtr
 CaService::CreateClientCertificate(const std::string_view &caSerial,
                                    const IssueCertificateModel &model) {
+  tracing::ScopedSpan span("CaService.CreateClientCertificate");
   auto caInfo = GetCaInfo(caSerial);
-  PKCS12ContainerUPtr container{nullptr};
-
-  if (model.subjectType == SujectTypeEnum::PhysicalPerson) {
-    auto req = new PhysicalPersonCertificateRequest();
-    container = _crypto->GenerateClientCertitificate(Map(*req, model), caInfo);
-    delete req;
-  } else if (model.subjectType == SujectTypeEnum::IndividualEntrepreneur) {
-    auto req = new IndividualEntrepreneurCertificateRequest();
-    container = _crypto->GenerateClientCertitificate(Map(*req, model), caInfo);
-    delete req;
-  } else if (model.subjectType == SujectTypeEnum::JuridicalPerson) {
-    auto req = new JuridicalPersonCertificateRequest();
-    container = _crypto->GenerateClientCertitificate(Map(*req, model), caInfo);
-    delete req;
-  } else {
-    LOG_ERROR("SubjectTypeEnum value: {} not supported.",
-              (int)model.subjectType);
-    throw std::runtime_error("Invalid SubjectTypeEnum value");
-  }
-
+  auto crlPartition = NextCrlPartition();
+  std::array<std::byte, ISSUE_ARENA_SIZE> buffer;
+  common::Arena arena(buffer.data(), buffer.size());
+  std::string_view commonName;
+  auto container = IssueBySubjectType(
+      model, crlPartition, arena, commonName, [&](const auto &req) {
+        return _crypto->GenerateClientCertitificate(req, *caInfo, arena);
+      });
   if (container == nullptr)
     throw std::runtime_error("Container is null");
-  SaveClientCertificate(caSerial, model.organizationName, container);
-  return std::move(container);
+  SaveClientCertificate(caSerial, commonName, container->serialNumber,
+                        container->thumbprint, container->notAfter,
+                        crlPartition);
+  LogArenaStats(arena);
+  return container;
+}
+
+template <typename TReq>
+static PKCS12ContainerUPtr GenerateClient(ICryptoProvider &crypto, TReq req,
+                                          const CaInfo &caInfo,
+                                          std::int32_t crlPartition) {
+  std::array<std::byte, ISSUE_ARENA_SIZE> buffer;
+  common::Arena arena(buffer.data(), buffer.size());
+  req.crlPartition = crlPartition;
+  auto client = crypto.GenerateClientCertitificate(req, caInfo, arena);
+  if (client == nullptr)
+    throw std::runtime_error("Container is null");
+  LogArenaStats(arena);
+  return client;
 }
 
 PKCS12ContainerUPtr CaService::CreateClientCertificate(
     const std::string_view &caSerial,
     const JuridicalPersonCertificateRequest &req) {
+  tracing::ScopedSpan span("CaService.CreateClientCertificate");
   auto caInfo = GetCaInfo(caSerial);
-  auto client = _crypto->GenerateClientCertitificate(req, caInfo);
-  if (client == nullptr)
-    throw std::runtime_error("Container is null");
-  SaveClientCertificate(caSerial, req.commonName, client);
-  return std::move(client);
+  auto crlPartition = NextCrlPartition();
+  auto client = GenerateClient(*_crypto, req, *caInfo, crlPartition);
+  SaveClientCertificate(caSerial, req.commonName, client->serialNumber,
+                        client->thumbprint, client->notAfter, crlPartition);
+  return client;
 }
 
 PKCS12ContainerUPtr CaService::CreateClientCertificate(
     const std::string_view &caSerial,
     const IndividualEntrepreneurCertificateRequest &req) {
+  tracing::ScopedSpan span("CaService.CreateClientCertificate");
   auto caInfo = GetCaInfo(caSerial);
-  auto client = _crypto->GenerateClientCertitificate(req, caInfo);
-  if (client == nullptr)
-    throw std::runtime_error("Container is null");
-  SaveClientCertificate(caSerial, req.commonName, client);
-  return std::move(client);
+  auto crlPartition = NextCrlPartition();
+  auto client = GenerateClient(*_crypto, req, *caInfo, crlPartition);
+  SaveClientCertificate(caSerial, req.commonName, client->serialNumber,
+                        client->thumbprint, client->notAfter, crlPartition);
+  return client;
 }
 
 PKCS12ContainerUPtr CaService::CreateClientCertificate(
     const std::string_view &caSerial,
     const PhysicalPersonCertificateRequest &req) {
+  tracing::ScopedSpan span("CaService.CreateClientCertificate");
   auto caInfo = GetCaInfo(caSerial);
-  auto client = _crypto->GenerateClientCertitificate(req, caInfo);
-  if (client == nullptr)
-    throw std::runtime_error("Container is null");
-  SaveClientCertificate(caSerial, req.commonName, client);
-  return std::move(client);
+  auto crlPartition = NextCrlPartition();
+  auto client = GenerateClient(*_crypto, req, *caInfo, crlPartition);
+  SaveClientCertificate(caSerial, req.commonName, client->serialNumber,
+                        client->thumbprint, client->notAfter, crlPartition);
+  return client;
 }
 
-std::vector<std::byte> CaService::GetCrl(const std::string &caSerial) {
-  auto crl = _db->GetActualCrl(caSerial);
+CertificateUPtr
+CaService::SignClientCertificate(const std::string_view &caSerial,
+                                 const SignCertificateModel &model) {
+  tracing::ScopedSpan span("CaService.SignClientCertificate");
+  auto caInfo = GetCaInfo(caSerial);
+  auto crlPartition = NextCrlPartition();
+  std::array<std::byte, ISSUE_ARENA_SIZE> buffer;
+  common::Arena arena(buffer.data(), buffer.size());
+  std::string_view commonName;
+  auto cert = IssueBySubjectType(
+      model, crlPartition, arena, commonName, [&](const auto &req) {
+        return _crypto->SignCertificateRequest(req, model.csr, *caInfo, arena);
+      });
+  if (cert == nullptr)
+    throw std::runtime_error("Certificate is null");
+  SaveClientCertificate(caSerial, commonName, cert->serialNumber,
+                        cert->thumbprint, cert->notAfter, crlPartition);
+  LogArenaStats(arena);
+  return cert;
+}
+
+std::vector<std::byte> CaService::GetCrl(const std::string &caSerial,
+                                         std::int32_t partition) {
+  tracing::ScopedSpan span("CaService.GetCrl");
+  if (partition < 0 || partition > _crlPartitions)
+    return std::vector<std::byte>();
+  auto crl = _db->GetActualCrl(caSerial, partition);
+  if (IsActual(crl))
+    return crl->content;
+
+  // one instance generates the next CRL, the others wait for its lock
+  std::vector<std::byte> content;
+  auto wait = crl == nullptr ? FIRST_CRL_LOCK_WAIT : CRL_LOCK_WAIT;
+  auto generated = _db->TryWithCrlLock(caSerial, partition, wait, [&] {
+    // may have been generated while the lock was held elsewhere
+    auto current = _db->GetActualCrl(caSerial, partition);
+    content = IsActual(current) ? current->content
+                                : InvalidateCrl(caSerial, partition);
+  });
+  if (generated)
+    return content;
   if (crl == nullptr)
-    return InvalidateCrl(caSerial);
-  if (crl->expireDate == nullptr || crl->expireDate < datetime::utc_now())
-    return InvalidateCrl(caSerial);
-  auto lastRevoked = _db->GetLastRevoked(caSerial);
-  if (lastRevoked != nullptr && crl->lastSerial != lastRevoked->serial)
-    return InvalidateCrl(caSerial);
+    throw std::runtime_error("CRL is being generated.");
+  LOG_WARNING("CRL {} of {} is being generated, previous one returned.",
+              partition, caSerial);
   return crl->content;
 }
 
-std::vector<std::byte> CaService::InvalidateCrl(const std::string &caSerial) {
+bool CaService::IsActual(const CrlModelPtr &crl) {
+  if (crl == nullptr)
+    return false;
+  if (crl->expireDate < datetime::utc_now())
+    return false;
+  auto lastRevoked = _db->GetLastRevoked(crl->caSerial, crl->partition);
+  return lastRevoked == nullptr || crl->lastSerial == lastRevoked->serial;
+}
+
+std::vector<std::byte> CaService::InvalidateCrl(const std::string &caSerial,
+                                                std::int32_t partition) {
+  tracing::ScopedSpan span("CaService.InvalidateCrl");
   // TODO: optimize db call
   auto issueDate = datetime::utc_now();
   auto expireDate = datetime::add_days(issueDate, 1);
-  auto crlInfo = _db->GetActualCrl(caSerial);
+  auto crlInfo = _db->GetActualCrl(caSerial, partition);
   auto caInfo = GetCaInfo(caSerial);
   long number = 1;
   if (crlInfo != nullptr) {
     number = crlInfo->number + 1;
   }
-  auto revokedCerts = _db->GetRevokedListOrderByRevokeDateDesc(caSerial);
+  // taken before the list: a revocation made in between makes the CRL
+  // stale rather than marked as including it
+  auto lastRevoked = _db->GetLastRevoked(caSerial, partition);
+  auto revokedCerts =
+      _db->GetRevokedListOrderByRevokeDateDesc(caSerial, partition, issueDate);
   CrlRequest req;
   req.number = number;
+  req.partition = partition;
   for (auto cert : revokedCerts) {
-    req.entries.push_back(CrlEntry{.serialNumber = cert->serial.data(),
-                                   .revokationDate = cert->revokeDate});
+    req.entries.push_back(CrlEntry{.serialNumber = cert->serialBytes,
+                                   .revokationDate = *cert->revokeDate});
   }
   std::sort(req.entries.begin(), req.entries.end(),
             [](const CrlEntry &a, const CrlEntry &b) {
-              return *a.revokationDate <= *b.revokationDate;
+              return a.revokationDate < b.revokationDate;
             });
-  std::string serial;
-  auto crl = _crypto->GenerateCrl(req, caInfo, issueDate, expireDate);
+  auto crl = _crypto->GenerateCrl(req, *caInfo, issueDate, expireDate);
   CrlModel model{.caSerial = caSerial,
+                 .partition = partition,
                  .number = number,
                  .issueDate = issueDate,
                  .expireDate = expireDate,
+                 // last revocation, included or expired, see IsActual
+                 .lastSerial = lastRevoked != nullptr
+                                   ? std::string(lastRevoked->serial)
+                                   : std::string(),
                  .content = crl.get()->content};
-  if (!req.entries.empty()) {
-    serial = req.entries[req.entries.size() - 1].serialNumber;
-    model.lastSerial = serial;
-  }
   _db->AddCrl(model);
+  static auto &rebuilds =
+      metrics::counter("caserv_crl_rebuilds_total", "Generated CRLs.");
+  rebuilds.Increment();
   return crl.get()->content;
 }
 
 void CaService::RevokeCertificate(const RevokeCertificateModel& model) {
+  tracing::ScopedSpan span("CaService.RevokeCertificate");
   auto cert = _db->GetCertificate(model.serial);
   if(cert == nullptr) throw std::runtime_error("Certificate not found.");
   auto revokationDate = datetime::utc_now();
-  _db->MakeCertificateRevoked(cert->serial, revokationDate);
+  _db->MakeCertificateRevoked(std::string(cert->serial), revokationDate);
+  static auto &revoked = metrics::counter("caserv_certificates_revoked_total",
+                                          "Revoked certificates.");
+  revoked.Increment();
 }
 
 
-CaInfo CaService::GetCaInfo(const std::string_view &caSerial) {
-  auto caCert = _db->GetCa(caSerial.data());
+CaInfoPtr CaService::GetCaInfo(const std::string_view &caSerial) {
+  tracing::ScopedSpan span("CaService.GetCaInfo");
+  std::string key(caSerial);
+  std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+  {
+    std::shared_lock<std::shared_mutex> lock(_caInfoMutex);
+    auto it = _caInfoCache.find(key);
+    if (it != _caInfoCache.end())
+      return it->second;
+  }
+
+  auto caCert = _db->GetCa(key);
   if (caCert == nullptr)
     throw std::runtime_error("Cannot find CA.");
-  auto crlUrl = std::format("{}/crl/{}.crl", caCert->publicUrl, caSerial);
-  auto caEndpoint = std::format("{}/crt/{}.crt", caCert->publicUrl, caSerial);
-  auto ocspEndpoint = std::format("{}/ocsp/{}", caCert->publicUrl, caSerial);
-  CaInfo caInfo{
+  auto crlUrl =
+      std::format("{}/crl/{}.crl", caCert->publicUrl, caCert->serial);
+  auto caEndpoint =
+      std::format("{}/crt/{}.crt", caCert->publicUrl, caCert->serial);
+  std::vector<std::string> partitionUrls;
+  for (std::int32_t partition = 1; partition <= _crlPartitions; ++partition)
+    partitionUrls.push_back(std::format("{}/crl/{}-{}.crl", caCert->publicUrl,
+                                        caCert->serial, partition));
+  auto caInfo = std::make_shared<CaInfo>(CaInfo{
+      .serial = key,
       .crlDistributionPoints = std::vector<std::string>{crlUrl},
+      .crlPartitionDistributionPoints = std::move(partitionUrls),
       .ocspEndPoints = std::vector<std::string>{},
       .caEndPoints = std::vector<std::string>{caEndpoint},
-      .privateKey = caCert->privateKey,
-      .certificate = caCert->certificate,
-  };
+      .privateKey = std::move(caCert->privateKey),
+      .certificate = std::move(caCert->certificate),
+  });
+
+  std::unique_lock<std::shared_mutex> lock(_caInfoMutex);
+  _caInfoCache.emplace(key, caInfo);
   return caInfo;
 }
 
 void CaService::SaveClientCertificate(const std::string_view &caSerial,
                                       const std::string_view &commonName,
-                                      const PKCS12ContainerUPtr &container) {
+                                      const std::string_view &serial,
+                                      const std::string_view &thumbprint,
+                                      const DateTime &expireDate,
+                                      std::int32_t crlPartition) {
   CertificateModel model;
   model.caSerial = caSerial;
-  model.serial = container->serialNumber;
-  model.thumbprint = container->thumbprint;
+  model.serial = serial;
+  model.thumbprint = thumbprint;
   model.commonName = commonName;
   auto dt = datetime::utc_now();
   model.issueDate = dt;
+  model.expireDate = expireDate;
+  model.crlPartition = crlPartition;
   _db->AddCertificate(model);
+  static auto &issued = metrics::counter("caserv_certificates_issued_total",
+                                         "Issued client certificates.");
+  issued.Increment();
 }
\ No newline at end of file
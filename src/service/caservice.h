@@ -4,10 +4,14 @@
 #include "./../base/icrypto_provider.h"
 #include "./../db/idatabase.h"
 #include "models/models.h"
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace serivce {
@@ -18,7 +22,9 @@ using namespace db::models;
 using namespace db;
 class CaService {
 public:
-  CaService(IDataBasePtr db, ICryptoProviderUPtr crypto);
+  // crlPartitions > 0 spreads certificates over that many partition CRLs
+  CaService(IDataBasePtr db, ICryptoProviderUPtr crypto,
+            std::int32_t crlPartitions = 0);
   ~CaService();
 
   StoredCertificateModelPtr GetCertificate(const std::string &serial);
@@ -27,23 +33,36 @@ public:
   StoredCertificateAuthorityModelPtr GetCa(const std::string &serial);
   std::vector<std::byte> GetCaCertificateData(const std::string &serial);
   std::vector<StoredCertificateAuthorityModelPtr> GetAllCa();
-  std::vector<std::byte> GetCrl(const std::string &caSerial);
-  std::vector<std::byte> InvalidateCrl(const std::string &caSerial);
+  // partition 0 - full CRL, empty result for unknown partition
+  std::vector<std::byte> GetCrl(const std::string &caSerial,
+                                std::int32_t partition = 0);
+  std::vector<std::byte> InvalidateCrl(const std::string &caSerial,
+                                       std::int32_t partition = 0);
 
   StoredCertificateAuthorityModelPtr CreateCA(const CreateCertificateAuthorityModel& model);
   PKCS12ContainerUPtr CreateClientCertificate(const std::string_view& caSerial, const IssueCertificateModel& model);
   PKCS12ContainerUPtr CreateClientCertificate(const std::string_view& caSerial, const JuridicalPersonCertificateRequest& req);
   PKCS12ContainerUPtr CreateClientCertificate(const std::string_view& caSerial, const IndividualEntrepreneurCertificateRequest& req);
   PKCS12ContainerUPtr CreateClientCertificate(const std::string_view& caSerial, const PhysicalPersonCertificateRequest& req);
+  CertificateUPtr SignClientCertificate(const std::string_view& caSerial, const SignCertificateModel& model);
 
   void RevokeCertificate(const RevokeCertificateModel& model);
 
 private:
-  CaInfo GetCaInfo(const std::string_view& caSerial);
-  void SaveClientCertificate(const std::string_view& caSerial, const std::string_view& commonName, const PKCS12ContainerUPtr& container);
+  CaInfoPtr GetCaInfo(const std::string_view& caSerial);
+  // not expired and includes the last revocation
+  bool IsActual(const CrlModelPtr& crl);
+  // round robin over partitions, 0 when CRL is not partitioned
+  std::int32_t NextCrlPartition();
+  void SaveClientCertificate(const std::string_view& caSerial, const std::string_view& commonName, const std::string_view& serial, const std::string_view& thumbprint, const DateTime& expireDate, std::int32_t crlPartition);
 private:
   IDataBasePtr _db;
   ICryptoProviderUPtr _crypto;
+  std::int32_t _crlPartitions;
+  std::atomic<std::uint32_t> _nextCrlPartition{0};
+  // CA certificate and key never change for a serial, cache signing material
+  std::unordered_map<std::string, CaInfoPtr> _caInfoCache;
+  std::shared_mutex _caInfoMutex;
 };
 
 using CaServicePtr = std::shared_ptr<CaService>;
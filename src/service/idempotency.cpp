@@ -0,0 +1,162 @@
+#include "idempotency.h"
+#include <openssl/evp.h>
+#include <exception>
+#include <span>
+#include <thread>
+#include <utility>
+
+#include "./../common/hex.h"
+#include "./../common/logger.h"
+#include "./../common/metrics.h"
+
+using namespace serivce;
+using namespace datetime;
+
+// pending key of a crashed instance is taken over after this period
+static constexpr std::chrono::seconds CLAIM_PERIOD{60};
+// duplicate of a request running on another instance
+static constexpr std::chrono::seconds WAIT_TIMEOUT{10};
+static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+static constexpr std::chrono::seconds PURGE_INTERVAL{60};
+
+static metrics::Counter &Requests(const char *result) {
+  return metrics::counter("caserv_idempotency_requests_total",
+                          "Requests with idempotency key by result.",
+                          {{"result", result}});
+}
+
+static void Release(IDataBase &db, const std::string &key) {
+  try {
+    db.DeleteIdempotencyKey(key);
+  } catch (const std::exception &ex) {
+    LOG_WARNING("Idempotency key {} is not released: {}", key, ex.what());
+  }
+}
+
+IdempotencyStore::IdempotencyStore(IDataBasePtr db, std::chrono::seconds ttl)
+    : _db(db), _ttl(ttl), _purgedAt(Clock::now()) {}
+
+IdempotentResultPtr IdempotencyStore::Execute(const std::string &key,
+                                              const std::string &fingerprint,
+                                              const Action &action) {
+  Purge();
+  std::promise<IdempotentResultPtr> promise;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    if (it != _entries.end() && it->second.expiresAt <= Clock::now()) {
+      _entries.erase(it);
+      it = _entries.end();
+    }
+    if (it != _entries.end()) {
+      if (it->second.fingerprint != fingerprint)
+        throw IdempotencyError(IdempotencyError::Reason::Mismatch,
+                               "Idempotency key is used with another request.");
+      auto result = it->second.result;
+      lock.unlock();
+      auto ready = result.wait_for(std::chrono::seconds(0)) ==
+                   std::future_status::ready;
+      Requests(ready ? "replayed" : "waited").Increment();
+      // failure of the original request is rethrown to duplicates
+      return result.get();
+    }
+    _entries.emplace(key, Entry{fingerprint, promise.get_future().share(),
+                                Clock::time_point::max()});
+  }
+  try {
+    auto result = Run(key, fingerprint, action);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (result == nullptr)
+        _entries.erase(key);
+      else
+        _entries[key].expiresAt = Clock::now() + _ttl;
+    }
+    promise.set_value(result);
+    return result;
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _entries.erase(key);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+}
+
+IdempotentResultPtr IdempotencyStore::Run(const std::string &key,
+                                          const std::string &fingerprint,
+                                          const Action &action) {
+  auto deadline = Clock::now() + WAIT_TIMEOUT;
+  while (!_db->ClaimIdempotencyKey(IdempotencyModel{
+      key, fingerprint, add_seconds(utc_now(), CLAIM_PERIOD.count()), {}})) {
+    auto stored = _db->GetIdempotencyKey(key);
+    if (stored != nullptr) {
+      if (stored->fingerprint != fingerprint)
+        throw IdempotencyError(IdempotencyError::Reason::Mismatch,
+                               "Idempotency key is used with another request.");
+      if (!stored->serial.empty()) {
+        Requests("rejected").Increment();
+        throw IdempotencyError(
+            IdempotencyError::Reason::Completed,
+            "Request with idempotency key is completed, certificate " +
+                stored->serial + ".");
+      }
+    }
+    // pending on another instance, or expired between claim and read
+    if (Clock::now() >= deadline)
+      throw IdempotencyError(IdempotencyError::Reason::InProgress,
+                             "Request with idempotency key is in progress.");
+    std::this_thread::sleep_for(POLL_INTERVAL);
+  }
+
+  IdempotentResultPtr result;
+  try {
+    result = action();
+  } catch (...) {
+    Release(*_db, key);
+    throw;
+  }
+  if (result == nullptr) {
+    Release(*_db, key);
+    return nullptr;
+  }
+  Requests("executed").Increment();
+  try {
+    _db->CompleteIdempotencyKey(IdempotencyModel{
+        key, fingerprint, add_seconds(utc_now(), _ttl.count()),
+        result->serial});
+  } catch (const std::exception &ex) {
+    // request is done, retries wait for claim period to expire
+    LOG_ERROR("Result of idempotency key {} is not stored: {}", key, ex.what());
+  }
+  return result;
+}
+
+void IdempotencyStore::Purge() {
+  auto now = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (now - _purgedAt < PURGE_INTERVAL)
+      return;
+    _purgedAt = now;
+    std::erase_if(_entries,
+                  [now](const auto &item) { return item.second.expiresAt <= now; });
+  }
+  try {
+    _db->DeleteExpiredIdempotencyKeys(utc_now());
+  } catch (const std::exception &ex) {
+    LOG_WARNING("Expired idempotency keys are not deleted: {}", ex.what());
+  }
+}
+
+std::string IdempotencyStore::Fingerprint(std::string_view data) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int length = 0;
+  if (EVP_Digest(data.data(), data.size(), digest, &length, EVP_sha256(),
+                 nullptr) != 1)
+    throw std::runtime_error("Request digest failed.");
+  // stored fingerprints are lower case
+  return hex::encode(std::span<const unsigned char>(digest, length),
+                     hex::Case::Lower);
+}
@@ -0,0 +1,101 @@
+#ifndef _CASERV_SERVICE_IDEMPOTENCY_H_
+#define _CASERV_SERVICE_IDEMPOTENCY_H_
+
+#include "./../db/idatabase.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace serivce {
+
+using namespace db;
+
+struct IdempotentResult {
+  std::string fileName;
+  // kept in memory only, holds the client private key
+  std::vector<std::byte> content;
+  // issued certificate, stored with the key
+  std::string serial;
+};
+
+using IdempotentResultPtr = std::shared_ptr<const IdempotentResult>;
+
+class IdempotencyError : public std::runtime_error {
+public:
+  enum class Reason {
+    // key was used with another request
+    Mismatch,
+    // request with the key still runs on another instance
+    InProgress,
+    // request with the key ran on another instance or before restart, its
+    // result cannot be replayed
+    Completed
+  };
+
+  IdempotencyError(Reason reason, const std::string &message)
+      : std::runtime_error(message), _reason(reason) {}
+  Reason GetReason() const { return _reason; }
+
+private:
+  Reason _reason;
+};
+
+/*
+    Runs requests carrying an idempotency key once. The first request claims
+    the key and runs, duplicates arriving meanwhile wait for its result and
+    later ones get the same result until TTL expires. Results hold client
+    private keys and are kept in memory only: the database stores the claim,
+    fingerprint and certificate serial, so retries reaching another instance
+    or arriving after a restart are rejected instead of run twice.
+*/
+class IdempotencyStore {
+public:
+  // null result - nothing to store (not found), key is released
+  using Action = std::function<IdempotentResultPtr()>;
+
+  IdempotencyStore(IDataBasePtr db, std::chrono::seconds ttl);
+
+  // fingerprint identifies the request, see Fingerprint
+  IdempotentResultPtr Execute(const std::string &key,
+                              const std::string &fingerprint,
+                              const Action &action);
+
+  // hex SHA-256 of request data
+  static std::string Fingerprint(std::string_view data);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    std::string fingerprint;
+    std::shared_future<IdempotentResultPtr> result;
+    // max while running
+    Clock::time_point expiresAt;
+  };
+
+  // claims key in database or returns result stored there
+  IdempotentResultPtr Run(const std::string &key,
+                          const std::string &fingerprint,
+                          const Action &action);
+  void Purge();
+
+  IDataBasePtr _db;
+  std::chrono::seconds _ttl;
+  std::mutex _mutex;
+  std::unordered_map<std::string, Entry> _entries;
+  Clock::time_point _purgedAt;
+};
+
+using IdempotencyStorePtr = std::shared_ptr<IdempotencyStore>;
+
+} // namespace serivce
+
+#endif //_CASERV_SERVICE_IDEMPOTENCY_H_
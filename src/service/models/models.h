@@ -7,6 +7,7 @@
 
 #include "./../../common/datetime.h"
 #include "./../../contracts/enums.h"
+#include "./../../db/models/models.h"
 #include "./../../libs/json.hpp"
 
 namespace service {
@@ -27,24 +28,13 @@ struct CreateCertificateAuthorityModel {
   std::string organizationName;
   uint16_t ttlInDays{365};
   std::string publicUrl;
+  std::string profile;
 };
 
-struct StoredCertificateAuthorityModel {
-  std::string serial;
-  std::string thumbprint;
-  std::string commonName;
-  DateTimePtr issueDate;
-  std::string publicUrl;
-};
-
-struct StoredCertificateModel {
-  std::string serial;
-  std::string thumbprint;
-  std::string caSerial;
-  std::string commonName;
-  DateTimePtr issueDate;
-  DateTimePtr revokeDate;
-};
+// db rows are returned as is, no per row conversion
+using StoredCertificateAuthorityModel =
+    db::models::CertificateAuthorityMetadataModel;
+using StoredCertificateModel = db::models::CertificateModel;
 
 struct IssueCertificateModel {
   SujectTypeEnum subjectType{SujectTypeEnum::PhysicalPerson};
@@ -66,6 +56,12 @@ struct IssueCertificateModel {
   std::string organizationUnitName;
   std::string title;
   std::string pin;
+  std::string profile;
+};
+
+// issue for client generated key, subject fields as in IssueCertificateModel
+struct SignCertificateModel : public IssueCertificateModel {
+  std::string csr; // PEM encoded PKCS#10 request
 };
 
 struct RevokeCertificateModel {
@@ -78,6 +74,7 @@ using StoredCertificateAuthorityModelPtr =
     std::shared_ptr<StoredCertificateAuthorityModel>;
 using StoredCertificateModelPtr = std::shared_ptr<StoredCertificateModel>;
 using IssueCertificateModelPtr = std::shared_ptr<IssueCertificateModel>;
+using SignCertificateModelPtr = std::shared_ptr<SignCertificateModel>;
 using RevokeCertificateModelPtr = std::shared_ptr<RevokeCertificateModel>;
 
 // TODO move to separated files
@@ -113,12 +110,10 @@ ValueType& try_get_to(const json& j, const KeyType& key, ValueType& value) {
   if(j.contains(key)) j.at(key).get_to(value);
 }
 
-//TODO: add validation for json model
-inline void from_json(const json &json, IssueCertificateModel &model) {
-  json.at("subjectType").get_to(model.subjectType);
-  json.at("algorithm").get_to(model.algorithm);
-  json.at("ttlInDays").get_to(model.ttlInDays);
+// optional subject fields, shared by issue and sign models
+inline void from_json_subject(const json &json, IssueCertificateModel &model) {
   if(json.contains("pin")) json.at("pin").get_to(model.pin);
+  if(json.contains("profile")) json.at("profile").get_to(model.profile);
   if(json.contains("country")) json.at("country").get_to(model.country);
   if(json.contains("localityName")) json.at("localityName").get_to(model.localityName);
   if(json.contains("stateOrProvinceName")) json.at("stateOrProvinceName").get_to(model.stateOrProvinceName);
@@ -136,10 +131,27 @@ inline void from_json(const json &json, IssueCertificateModel &model) {
   if(json.contains("title")) json.at("title").get_to(model.title);
 }
 
+//TODO: add validation for json model
+inline void from_json(const json &json, IssueCertificateModel &model) {
+  json.at("subjectType").get_to(model.subjectType);
+  json.at("algorithm").get_to(model.algorithm);
+  json.at("ttlInDays").get_to(model.ttlInDays);
+  from_json_subject(json, model);
+}
+
+// algorithm is defined by the request key
+inline void from_json(const json &json, SignCertificateModel &model) {
+  json.at("subjectType").get_to(model.subjectType);
+  json.at("ttlInDays").get_to(model.ttlInDays);
+  json.at("csr").get_to(model.csr);
+  from_json_subject(json, model);
+}
+
 inline void from_json(const json &json, CreateCertificateAuthorityModel &model) {
   json.at("algorithm").get_to(model.algorithm);
   json.at("ttlInDays").get_to(model.ttlInDays);
   json.at("publicUrl").get_to(model.publicUrl);
+  if(json.contains("profile")) json.at("profile").get_to(model.profile);
   
   if(json.contains("country")) json.at("country").get_to(model.country);
   if(json.contains("localityName")) json.at("localityName").get_to(model.localityName);
@@ -151,19 +163,27 @@ inline void from_json(const json &json, CreateCertificateAuthorityModel &model)
   if(json.contains("organizationName")) json.at("organizationName").get_to(model.organizationName);
 }
 
-inline void to_json(json &j, const service::models::StoredCertificateModelPtr &model) {
+} // namespace models
+} // namespace service
+
+// Stored* models are db rows, to_json must be visible to ADL in db::models
+namespace db {
+namespace models {
+
+inline void to_json(nlohmann::json &j, const CertificateModelPtr &model) {
   j["serial"] = model->serial;
   j["thumbprint"] = model->thumbprint;
   j["caSerial"] = model->caSerial;
   j["commonName"] = model->commonName;
   j["issueDate"] = datetime::to_utcstring(model->issueDate);
-  if (model->revokeDate != nullptr)
-    j["revokeDate"] = datetime::to_utcstring(model->revokeDate);
+  if (model->expireDate.has_value())
+    j["expireDate"] = datetime::to_utcstring(*model->expireDate);
+  if (model->revokeDate.has_value())
+    j["revokeDate"] = datetime::to_utcstring(*model->revokeDate);
 }
 
-inline void
-to_json(json &j,
-        const service::models::StoredCertificateAuthorityModelPtr &model) {
+inline void to_json(nlohmann::json &j,
+                    const CertificateAuthorityMetadataModelPtr &model) {
   j["serial"] = model->serial;
   j["thumbprint"] = model->thumbprint;
   j["commonName"] = model->commonName;
@@ -172,6 +192,6 @@ to_json(json &j,
 }
 
 } // namespace models
-} // namespace service
+} // namespace db
 
 #endif //_CASERV_SERVICE_MODELS_H_
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include "./../postgre/type_spesc/binary_spec.h"
+
+using namespace postgre::binary;
+
+TEST(BinarySpec, ReadsTimestampAtPostgresEpoch) {
+  const char data[8] = {};
+  EXPECT_EQ(read_timestamp(data).value, PG_EPOCH_UNIX);
+}
+
+TEST(BinarySpec, DropsMicroseconds) {
+  // 1 s 500000 us after 2000-01-01
+  const char data[8] = {0, 0, 0, 0, 0, 0x16, static_cast<char>(0xE3), 0x60};
+  EXPECT_EQ(read_timestamp(data).value, PG_EPOCH_UNIX + 1);
+}
+
+TEST(BinarySpec, FloorsTimestampBefore2000) {
+  // -1 us is 1999-12-31 23:59:59.999999
+  const char data[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+  EXPECT_EQ(read_timestamp(data).value, PG_EPOCH_UNIX - 1);
+}
+
+TEST(BinarySpec, TimestampRoundTrips) {
+  char data[8];
+  for (std::time_t value : {std::time_t{0}, std::time_t{1709214310},
+                            std::time_t{PG_EPOCH_UNIX - 86400}}) {
+    write_timestamp(data, datetime::DateTime{value});
+    EXPECT_EQ(read_timestamp(data).value, value);
+  }
+}
+
+TEST(BinarySpec, ReadsIntegersInNetworkOrder) {
+  const char int32[4] = {0x12, 0x34, 0x56, 0x78};
+  EXPECT_EQ(read_int32(int32), 0x12345678);
+  const char minus[4] = {-1, -1, -1, -2};
+  EXPECT_EQ(read_int32(minus), -2);
+  char int64[8];
+  write_int64(int64, -1234567890123);
+  EXPECT_EQ(read_int64(int64), -1234567890123);
+}
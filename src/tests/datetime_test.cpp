@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include "./../common/datetime.h"
+
+using namespace datetime;
+
+TEST(DateTime, ParsesPostgresOutput) {
+  DateTime result;
+  ASSERT_TRUE(try_parse("2024-02-29 13:45:10+00", result));
+  EXPECT_EQ(result.value, 1709214310);
+  ASSERT_TRUE(try_parse("2024-02-29 13:45:10.123456+00", result));
+  EXPECT_EQ(result.value, 1709214310);
+  ASSERT_TRUE(try_parse("2024-02-29T13:45:10Z", result));
+  EXPECT_EQ(result.value, 1709214310);
+  ASSERT_TRUE(try_parse("2024-02-29 13:45:10 UTC", result));
+  EXPECT_EQ(result.value, 1709214310);
+  ASSERT_TRUE(try_parse("2024-02-29 13:45:10", result));
+  EXPECT_EQ(result.value, 1709214310);
+}
+
+TEST(DateTime, AppliesZoneOffset) {
+  DateTime result;
+  ASSERT_TRUE(try_parse("2024-02-29 16:45:10+03", result));
+  EXPECT_EQ(result.value, 1709214310);
+  ASSERT_TRUE(try_parse("2024-02-29 08:15:10-05:30", result));
+  EXPECT_EQ(result.value, 1709214310);
+  ASSERT_TRUE(try_parse("2024-02-29 13:45:40+00:00:30", result));
+  EXPECT_EQ(result.value, 1709214310);
+}
+
+TEST(DateTime, ParsesBeforeUnixEpoch) {
+  DateTime result;
+  ASSERT_TRUE(try_parse("1969-12-31 23:59:59+00", result));
+  EXPECT_EQ(result.value, -1);
+}
+
+TEST(DateTime, RejectsInvalidText) {
+  DateTime result{42};
+  EXPECT_FALSE(try_parse("", result));
+  EXPECT_FALSE(try_parse("2024-02-29", result));
+  EXPECT_FALSE(try_parse("2024-13-01 00:00:00", result));
+  EXPECT_FALSE(try_parse("2024-01-32 00:00:00", result));
+  EXPECT_FALSE(try_parse("2024-01-01 00:60:00", result));
+  EXPECT_FALSE(try_parse("2024/01/01 00:00:00", result));
+  EXPECT_FALSE(try_parse("2024-01-01 00:00:00 MSK", result));
+  EXPECT_FALSE(try_parse("2024-01-01 00:00:00+0x", result));
+  EXPECT_EQ(result.value, 42);
+  EXPECT_THROW(from_utcstring("not a date"), std::invalid_argument);
+}
+
+TEST(DateTime, FormatsUtc) {
+  char buffer[UTC_STRING_SIZE];
+  auto end = format_utc(buffer, DateTime{1709214310});
+  EXPECT_EQ(std::string(buffer, end), "2024-02-29 13:45:10 UTC");
+  EXPECT_EQ(to_utcstring(DateTime{0}), "1970-01-01 00:00:00 UTC");
+  EXPECT_EQ(to_utcstring(DateTime{-1}), "1969-12-31 23:59:59 UTC");
+}
+
+TEST(DateTime, FormatRoundTrips) {
+  for (std::time_t value : {std::time_t{0}, std::time_t{951782400},
+                            std::time_t{4102444799}, std::time_t{-86401}})
+    EXPECT_EQ(from_utcstring(to_utcstring(DateTime{value})).value, value);
+}
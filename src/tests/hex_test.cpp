@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include "./../common/hex.h"
+
+TEST(Hex, EncodesUpperCaseByDefault) {
+  const std::array<unsigned char, 4> bytes{0x00, 0x9A, 0xBC, 0xFF};
+  EXPECT_EQ(hex::encode(bytes), "009ABCFF");
+  EXPECT_EQ(hex::encode(bytes, hex::Case::Lower), "009abcff");
+}
+
+TEST(Hex, DecodesBothCases) {
+  auto expected = std::vector<std::byte>{std::byte{0x9A}, std::byte{0xBC}};
+  EXPECT_EQ(hex::decode("9abc"), expected);
+  EXPECT_EQ(hex::decode("9ABC"), expected);
+}
+
+TEST(Hex, LeftPadsOddLength) {
+  auto expected = std::vector<std::byte>{std::byte{0x0A}, std::byte{0xBC}};
+  EXPECT_EQ(hex::decoded_size("ABC"), 2u);
+  EXPECT_EQ(hex::decode("ABC"), expected);
+}
+
+TEST(Hex, FailsOnNotHexChar) {
+  for (auto text : {"0G", "G0", "12 4", "-1", "0x12", "ABC@"})
+    EXPECT_TRUE(hex::decode(text).empty()) << text;
+  std::byte buffer[2];
+  EXPECT_FALSE(hex::decode("Z1", buffer));
+  EXPECT_FALSE(hex::decode("1Z", buffer));
+}
+
+TEST(Hex, EmptyInput) {
+  EXPECT_EQ(hex::encode(std::span<const std::byte>()), "");
+  EXPECT_TRUE(hex::decode("").empty());
+}
+
+TEST(Hex, RoundTripsEveryByte) {
+  std::vector<std::byte> bytes;
+  for (int i = 0; i < 256; ++i)
+    bytes.push_back(static_cast<std::byte>(i));
+  EXPECT_EQ(hex::decode(hex::encode(bytes)), bytes);
+  EXPECT_EQ(hex::decode(hex::encode(bytes, hex::Case::Lower)), bytes);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+#include "./../common/lru_cache.h"
+
+using Cache = common::LruCache<std::string, int>;
+using namespace std::chrono_literals;
+
+TEST(LruCache, EvictsLeastRecentlyUsed) {
+  Cache cache(2);
+  cache.Put("a", 1, 1min);
+  cache.Put("b", 2, 1min);
+  EXPECT_EQ(cache.Get("a"), 1);
+  cache.Put("c", 3, 1min);
+  EXPECT_EQ(cache.Get("b"), std::nullopt);
+  EXPECT_EQ(cache.Get("a"), 1);
+  EXPECT_EQ(cache.Get("c"), 3);
+  EXPECT_EQ(cache.Size(), 2u);
+}
+
+TEST(LruCache, PutReplacesValue) {
+  Cache cache(2);
+  cache.Put("a", 1, 1min);
+  cache.Put("a", 2, 1min);
+  EXPECT_EQ(cache.Get("a"), 2);
+  EXPECT_EQ(cache.Size(), 1u);
+}
+
+TEST(LruCache, ExpiresEntries) {
+  Cache cache(2);
+  cache.Put("a", 1, 10ms);
+  cache.Put("b", 2, 1min);
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(cache.Get("a"), std::nullopt);
+  EXPECT_EQ(cache.Get("b"), 2);
+  EXPECT_EQ(cache.Size(), 1u);
+}
+
+TEST(LruCache, ZeroCapacityOrTtlDisablesPut) {
+  Cache disabled(0);
+  disabled.Put("a", 1, 1min);
+  EXPECT_EQ(disabled.Get("a"), std::nullopt);
+  Cache cache(2);
+  cache.Put("a", 1, 0s);
+  EXPECT_EQ(cache.Get("a"), std::nullopt);
+}
+
+TEST(LruCache, InvalidationChangesGeneration) {
+  Cache cache(2);
+  auto generation = cache.Generation();
+  cache.Erase("missing");
+  EXPECT_NE(cache.Generation(), generation);
+  generation = cache.Generation();
+  cache.Clear();
+  EXPECT_NE(cache.Generation(), generation);
+}
+
+TEST(LruCache, SkipsPutOfStaleLoad) {
+  Cache cache(2);
+  auto generation = cache.Generation();
+  // value loaded before the erase must not be put back
+  cache.Erase("a");
+  cache.Put("a", 1, 1min, generation);
+  EXPECT_EQ(cache.Get("a"), std::nullopt);
+  cache.Put("a", 2, 1min, cache.Generation());
+  EXPECT_EQ(cache.Get("a"), 2);
+}
+
+TEST(LruCache, EraseAndClearRemoveEntries) {
+  Cache cache(3);
+  cache.Put("a", 1, 1min);
+  cache.Put("b", 2, 1min);
+  cache.Erase("a");
+  EXPECT_EQ(cache.Get("a"), std::nullopt);
+  EXPECT_EQ(cache.Get("b"), 2);
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0u);
+}